@@ -0,0 +1,158 @@
+// MJPEG Stream Splitter Benchmark
+// Compares the memchr-based MJPEGStreamSplitter against the original
+// byte-by-byte push_back loop from CameraFrameSource on a recorded stream.
+//
+// Record a stream on the Pi:
+//   rpicam-vid --codec mjpeg --width 1640 --height 1232 --framerate 41 -t 10000 -o stream.mjpeg
+// Then run:
+//   ./benchmark_mjpeg_splitter stream.mjpeg [iterations]
+// Without a file a synthetic stream is generated instead.
+
+#include "core/MJPEGStreamSplitter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+static const size_t kChunkSize = 8192;
+
+// Synthetic MJPEG-like stream: SOI, random entropy data with byte stuffing, EOI
+static vector<uint8_t> makeSyntheticStream(int frames, size_t frame_size) {
+    vector<uint8_t> stream;
+    stream.reserve(frames * (frame_size + 4));
+    mt19937 rng(42);
+    uniform_int_distribution<int> byte_dist(0, 255);
+
+    for (int f = 0; f < frames; f++) {
+        stream.push_back(0xFF);
+        stream.push_back(0xD8);
+        for (size_t i = 0; i < frame_size; i++) {
+            uint8_t b = static_cast<uint8_t>(byte_dist(rng));
+            stream.push_back(b);
+            if (b == 0xFF) {
+                stream.push_back(0x00);  // Stuffed byte, as in real entropy-coded data
+            }
+        }
+        stream.push_back(0xFF);
+        stream.push_back(0xD9);
+    }
+    return stream;
+}
+
+// Original CameraFrameSource::getFrameInternal scanning loop (decode removed)
+static size_t splitLegacy(const vector<uint8_t>& stream, vector<size_t>& sizes) {
+    vector<uint8_t> frame_buffer;
+    frame_buffer.reserve(1640 * 1232);
+    uint8_t prev_byte = 0;
+    bool found_start = false;
+    size_t pos = 0;
+
+    while (pos < stream.size()) {
+        // Simulate fread() into a stack chunk
+        uint8_t buffer[kChunkSize];
+        size_t bytes_read = min(kChunkSize, stream.size() - pos);
+        memcpy(buffer, stream.data() + pos, bytes_read);
+        pos += bytes_read;
+
+        for (size_t i = 0; i < bytes_read; i++) {
+            uint8_t byte = buffer[i];
+            if (!found_start) {
+                if (prev_byte == 0xFF && byte == 0xD8) {
+                    found_start = true;
+                    frame_buffer.clear();
+                    frame_buffer.push_back(0xFF);
+                    frame_buffer.push_back(0xD8);
+                }
+            } else {
+                frame_buffer.push_back(byte);
+                if (prev_byte == 0xFF && byte == 0xD9) {
+                    sizes.push_back(frame_buffer.size());
+                    found_start = false;
+                }
+            }
+            prev_byte = byte;
+        }
+    }
+    return sizes.size();
+}
+
+static size_t splitWithSplitter(const vector<uint8_t>& stream, vector<size_t>& sizes) {
+    TVLED::MJPEGStreamSplitter splitter(1640 * 1232);
+    size_t pos = 0;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    while (pos < stream.size()) {
+        // Simulate read() into the splitter buffer
+        size_t bytes_read = min(kChunkSize, stream.size() - pos);
+        memcpy(splitter.writeBuffer(bytes_read), stream.data() + pos, bytes_read);
+        splitter.commit(bytes_read);
+        pos += bytes_read;
+
+        while (splitter.nextFrame(data, size)) {
+            sizes.push_back(size);
+        }
+    }
+    return sizes.size();
+}
+
+template <typename Fn>
+static double timeRuns(Fn fn, const vector<uint8_t>& stream, int iterations, vector<size_t>& sizes) {
+    auto start = high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sizes.clear();
+        fn(stream, sizes);
+    }
+    auto end = high_resolution_clock::now();
+    return duration_cast<microseconds>(end - start).count() / 1000.0;
+}
+
+int main(int argc, char* argv[]) {
+    vector<uint8_t> stream;
+    int iterations = (argc > 2) ? atoi(argv[2]) : 20;
+
+    if (argc > 1) {
+        ifstream file(argv[1], ios::binary);
+        if (!file) {
+            cerr << "Could not open " << argv[1] << endl;
+            return 1;
+        }
+        stream.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        cout << "Loaded " << argv[1] << " (" << stream.size() / (1024.0 * 1024.0) << " MB)" << endl;
+    } else {
+        stream = makeSyntheticStream(200, 150 * 1024);
+        cout << "No stream given, using synthetic stream ("
+             << stream.size() / (1024.0 * 1024.0) << " MB)" << endl;
+    }
+
+    vector<size_t> legacy_sizes, splitter_sizes;
+    double legacy_ms = timeRuns(splitLegacy, stream, iterations, legacy_sizes);
+    double splitter_ms = timeRuns(splitWithSplitter, stream, iterations, splitter_sizes);
+
+    double mb = stream.size() * static_cast<double>(iterations) / (1024.0 * 1024.0);
+    size_t frames = legacy_sizes.size();
+
+    cout << "\n=== MJPEG Splitting (" << iterations << " iterations, " << frames << " frames each) ===" << endl;
+    cout << "Legacy push_back loop: " << legacy_ms << " ms (" << mb / (legacy_ms / 1000.0) << " MB/s, "
+         << (legacy_ms * 1000.0) / (frames * iterations) << " us/frame)" << endl;
+    cout << "memchr splitter:       " << splitter_ms << " ms (" << mb / (splitter_ms / 1000.0) << " MB/s, "
+         << (splitter_ms * 1000.0) / (splitter_sizes.size() * iterations) << " us/frame)" << endl;
+    cout << "Speedup: " << legacy_ms / splitter_ms << "x" << endl;
+
+    if (legacy_sizes != splitter_sizes) {
+        cerr << "\nMISMATCH: legacy found " << legacy_sizes.size() << " frames, splitter found "
+             << splitter_sizes.size() << endl;
+        return 1;
+    }
+    cout << "Frame boundaries identical (" << frames << " frames)" << endl;
+    return 0;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <chrono>
 #include <vector>
 #include <string>
 #include <memory>
@@ -8,6 +9,7 @@
 #include <flatbuffers/flatbuffers.h>
 #include "flatbuffer/hyperion_request_generated.h"
 #include "communication/LEDLayout.h"
+#include "utils/LatencyHistogram.h"
 
 namespace TVLED {
 
@@ -26,13 +28,17 @@ public:
     // Colors must be in RGB (R,G,B) 8-bit per channel.
     // If your source is OpenCV BGR, convert before calling.
     // LED layout is used to create proper 2D image structure.
-    bool sendColors(const std::vector<cv::Vec3b>& colors, const LEDLayout& layout);
+    // captured (steady_clock) is the frame's capture time, recorded in latency()
+    // once the message is written; leave it default when unknown.
+    bool sendColors(const std::vector<cv::Vec3b>& colors, const LEDLayout& layout,
+                    std::chrono::steady_clock::time_point captured = {});
     
     // Send LED colors to HyperHDR using linear format (1 pixel tall, width = LED count)
     // Each pixel in the single row represents one LED's color directly.
     // Colors must be in RGB (R,G,B) 8-bit per channel.
     // This is the standard way to send per-LED color frames using FlatBuffers.
-    bool sendColorsLinear(const std::vector<cv::Vec3b>& colors);
+    bool sendColorsLinear(const std::vector<cv::Vec3b>& colors,
+                          std::chrono::steady_clock::time_point captured = {});
     
     // Check if connected
     bool isConnected() const { return connected_; }
@@ -40,6 +46,9 @@ public:
     // Set priority (lower = higher priority)
     void setPriority(int priority) { priority_ = priority; }
     
+    // Capture -> message written to the socket, for sends given a capture time
+    LatencyHistogram& latency() { return latency_; }
+    
 private:
     std::string host_;
     int port_;
@@ -48,9 +57,11 @@ private:
     bool connected_;
     int socket_fd_;
     sockaddr_in server_addr_;
+    LatencyHistogram latency_;
     
     // Helper methods
     bool sendTCPMessage(const uint8_t* data, size_t size);
+    bool sendFrameMessage(const std::vector<uint8_t>& message, std::chrono::steady_clock::time_point captured);
     bool registerWithHyperHDR();
     std::vector<uint8_t> createFlatBufferMessage(const std::vector<cv::Vec3b>& colors, const LEDLayout& layout);
     std::vector<uint8_t> createFlatBufferMessageLinear(const std::vector<cv::Vec3b>& colors);
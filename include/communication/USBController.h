@@ -1,9 +1,11 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <chrono>
 #include <vector>
 #include <string>
 #include <memory>
+#include "utils/LatencyHistogram.h"
 
 namespace TVLED {
 
@@ -48,9 +50,12 @@ public:
      * If your source is OpenCV BGR, convert before calling.
      * 
      * @param colors Vector of RGB colors (one per LED)
+     * @param captured Capture time of the frame (steady_clock), recorded in
+     *                 latency() once written; leave default when unknown
      * @return true if data sent successfully, false otherwise
      */
-    bool sendColors(const std::vector<cv::Vec3b>& colors);
+    bool sendColors(const std::vector<cv::Vec3b>& colors,
+                    std::chrono::steady_clock::time_point captured = {});
     
     /**
      * Check if connected to USB device
@@ -69,12 +74,19 @@ public:
      * @return Baud rate
      */
     int getBaudrate() const { return baudrate_; }
+    
+    /**
+     * Capture -> packet written to the serial port, for sends given a capture time
+     * @return Latency histogram of this device
+     */
+    LatencyHistogram& latency() { return latency_; }
 
 private:
     std::string device_;
     int baudrate_;
     bool connected_;
     int fd_;  // File descriptor for serial port
+    LatencyHistogram latency_;
     
     /**
      * Create protocol packet from RGB data
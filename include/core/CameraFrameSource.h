@@ -1,11 +1,20 @@
 #pragma once
 
 #include "core/FrameSource.h"
+#include "core/JpegDecoder.h"
+#include "core/MJPEGRecorder.h"
+#include "core/MJPEGStreamSplitter.h"
+#include "utils/FramePool.h"
 #include <opencv2/core.hpp>
 #include <opencv2/videoio.hpp>
+#include <chrono>
 #include <string>
 #include <memory>
-#include <cstdio>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <sys/types.h>
 
 namespace TVLED {
 
@@ -21,14 +30,56 @@ public:
                      float awb_temperature = 0.0f, float analogue_gain = 0.0f, float digital_gain = 0.0f,
                      int exposure_time = 0, const std::vector<float>& color_correction_matrix = {},
                      bool enable_scaling = true, int scaled_width = 960, int scaled_height = 540,
-                     bool flip_horizontal = false, bool flip_vertical = false);
+                     bool flip_horizontal = false, bool flip_vertical = false,
+                     const std::string& codec = "mjpeg", int yuv_stride = 0,
+                     bool dct_scaling = true, bool fast_decode = false,
+                     bool native_output = false);
     ~CameraFrameSource() override;
     
     bool initialize() override;
-    bool getFrame(cv::Mat& frame) override;
+    using FrameSource::getFrame;
+    bool getFrame(cv::Mat& frame, FrameTiming& timing) override;
     void release() override;
     std::string getName() const override;
     bool isReady() const override;
+    void setRegionsOfInterest(const std::vector<cv::Rect>& regions) override;
+    FrameSourceStats getStats() const override;
+    void interrupt() override;
+    
+    // Camera process supervision, call before initialize().
+    // A read that sees no data for stall_timeout_ms (or EOF) restarts rpicam-vid,
+    // up to max_restarts times in a row with exponential backoff from restart_delay_ms.
+    void setRecoveryOptions(int stall_timeout_ms, int max_restarts,
+                            int restart_delay_ms, int pipe_buffer_size);
+    
+    // Tee the settled MJPEG stream to path (+ path.pts timestamps), call before initialize()
+    void setRecordPath(const std::string& path);
+    
+    // Take capture times from rpicam-vid's --save-pts output instead of arrival times
+    void setSensorTimestamps(bool enable);
+    
+    // Read everything the pipe holds before each frame and decode only the newest
+    // complete one; older frames are counted as skipped instead of decoded
+    void setDrainToNewest(bool enable);
+
+protected:
+    // Stream hooks for sources that feed recorded data through the same decode path.
+    // openStream() returns a readable fd (default: spawn rpicam-vid, -1 on failure).
+    // onEndOfStream() returns true after repositioning fd to keep reading.
+    virtual int openStream();
+    virtual bool onEndOfStream(int fd);
+    virtual bool needsWarmup() const { return true; }
+    
+    // One frame from the open stream (decode, scale, flip), no recovery
+    bool readFrame(cv::Mat& frame, FrameTiming& timing);
+    
+    // Sequence number the next frame split from the stream will get
+    uint64_t nextSequence() const { return stream_frames_; }
+    
+    // interrupt() was called since initialize(); blocking waits must check it
+    // at least every INTERRUPT_SLICE
+    bool interrupted() const { return interrupted_; }
+    static constexpr std::chrono::milliseconds INTERRUPT_SLICE{50};
 
 private:
     std::string device_;
@@ -57,14 +108,80 @@ private:
     bool flip_horizontal_;
     bool flip_vertical_;
     
-    // For piped camera input
-    FILE* camera_pipe_;
-    std::vector<uint8_t> frame_buffer_;
-    std::string temp_file_;  // Temporary file for frame storage
+    // Stream format: "mjpeg" (decoded per frame) or "yuv420" (raw I420, no decode)
+    std::string codec_;
+    int yuv_stride_;  // Luma row stride of the yuv420 stream (0 = width aligned to 64)
+    std::vector<uint8_t> yuv_buffer_;  // Padded frame staging when stride != width
+    
+    // JPEG decode: scale in the DCT domain towards the scaled size
+    bool dct_scaling_;
+    bool fast_decode_;
+    JpegDecoder decoder_;
+    
+    // Deliver frames as decoded (no resize/flip); geometry is mapped instead
+    bool native_output_;
+    
+    // Regions of interest handed over from the processing thread
+    std::mutex roi_mutex_;
+    std::vector<cv::Rect> pending_roi_;
+    cv::Size pending_roi_space_;
+    std::atomic<bool> roi_pending_;
+    std::atomic<bool> interrupted_;
+    
+    // Camera child process and the read end of its stdout pipe (non-blocking)
+    int camera_fd_;
+    pid_t camera_pid_;
+    bool waiting_for_first_frame_;
+    
+    // Recovery policy
+    int stall_timeout_ms_;
+    int max_restarts_;
+    int restart_delay_ms_;
+    int pipe_buffer_size_;
+    int consecutive_restarts_;
+    std::atomic<int> total_restarts_;
+    std::atomic<uint64_t> frames_captured_;
+    bool drain_to_newest_;
+    std::atomic<uint64_t> frames_skipped_;
+    
+    // Every decoded, resized, flipped or raw frame lives in a pooled buffer
+    FramePool frame_pool_;
+    
+    // Timing of the frame being read; PTS lines arrive on their own pipe
+    bool sensor_timestamps_;
+    int pts_fd_;
+    FrameTiming frame_timing_;
+    uint64_t stream_frames_;        // Frames seen since the camera (re)started
+    std::deque<double> pts_ms_;     // Unmatched PTS, the first one belongs to frame pts_first_index_
+    uint64_t pts_first_index_;
+    std::string pts_text_;          // Partial line
+    bool pts_anchored_;
+    FrameTiming::Clock::time_point pts_origin_;
+    
+    MJPEGStreamSplitter splitter_;  // Reusable stream buffer, JPEGs are decoded in place
+    
+    std::string record_path_;
+    MJPEGRecorder recorder_;
     
     // Helper methods
     int parseCameraIndex() const;
+    std::vector<std::string> buildCommand() const;
+    bool startCamera();
+    void stopCamera();
+    bool restartCamera();                    // False once max_restarts_ is exhausted
+    void configureStream();                  // Decoder / stride setup for the configured codec
+    bool readSome(uint8_t* data, size_t size, size_t& bytes_read);  // Waits up to the stall timeout
+    bool decodeFrame(cv::Mat& bgr);          // Next JPEG decoded into a pooled buffer
     bool getFrameInternal(cv::Mat& frame);  // Internal frame reading
+    bool getFrameYUV420(cv::Mat& frame);    // Read one raw I420 frame (rows = height * 3/2)
+    bool readExact(uint8_t* data, size_t size);
+    void drainPipe(size_t chunk_size);       // Non-blocking read of everything available
+    void stampFrame();                       // Record timing of the frame just read
+    void attachSensorTimestamp(FrameTiming& timing);  // PTS of a frame being handed out, if read
+    void drainTimestamps();
+    bool sensorTimestamp(uint64_t sequence, double& pts_ms);
+    int outputWidth() const;
+    int outputHeight() const;
 };
 
 } // namespace TVLED
@@ -38,6 +38,74 @@ struct CameraConfig {
     bool enable_scaling = true;
     int scaled_width = 820;   // Scale down 2x for performance
     int scaled_height = 616;  // Maintains aspect ratio
+    
+    // Capture/decode on a dedicated thread, processing always takes the newest frame
+    bool capture_thread = true;
+    
+    // Stream format from rpicam-vid: "mjpeg" or "yuv420" (raw I420, no JPEG decode)
+    std::string codec = "mjpeg";
+    int yuv_stride = 0;  // Y row stride of yuv420 frames in bytes (0 = width rounded up to 64)
+    
+    // MJPEG decode: decode at 1/2, 1/4 or 1/8 scale towards scaled_width/height
+    // instead of decoding full size and resizing. The scaled IDCT averages each
+    // 8x8 block down, close to an area resize, so region means barely move.
+    // fast_decode adds the integer fast IDCT and nearest-neighbour chroma
+    // upsampling: a little faster, but values drift by a level or two and
+    // chroma bleeds across sharp color edges, so it is off by default
+    bool dct_scaling = true;
+    bool fast_decode = false;
+    
+    // Only decode the MCUs covering LED sampling regions (needs libjpeg-turbo)
+    bool roi_decode = true;
+    
+    // Camera process recovery: restart rpicam-vid when it exits or sends nothing
+    // for stall_timeout_ms, giving up after max_restarts failed restarts in a row
+    int stall_timeout_ms = 1000;
+    int max_restarts = 5;
+    int restart_delay_ms = 200;  // Doubles per consecutive restart, capped at 5 s
+    int pipe_buffer_size = 1048576;  // Camera pipe capacity in bytes (0 = kernel default)
+    
+    // Decode only the newest complete frame in the pipe, skipping stale ones
+    // (keeps latency bounded when processing is slower than the camera)
+    bool drain_to_newest = false;
+    
+    // Capture times from rpicam-vid --save-pts (sensor timestamps) instead of arrival times
+    bool sensor_timestamps = true;
+    
+    // Tee the raw MJPEG stream to this file (+ .pts timestamps) for replay mode ("" = off)
+    std::string record_path;
+};
+
+// Replay mode: play back a camera recording through the normal decode path.
+// Camera size, scaling and flip settings should match the recording.
+struct ReplayConfig {
+    std::string path;
+    bool realtime = true;  // Pace by recorded timestamps, false = as fast as frames decode
+    bool loop = false;
+};
+
+// Synthetic mode: generated frames for benchmarks ("gradient", "bars", "noise", "letterbox", "static")
+struct SyntheticConfig {
+    std::string pattern = "bars";
+    int width = 1920;
+    int height = 1080;
+    int fps = 0;  // 0 = as fast as possible
+};
+
+// Batch mode: run extraction on every frame of a video file and write the
+// LED color timeline as CSV. Frames get the camera's scaling and flip so the
+// geometry lines up exactly as in live mode.
+struct BatchConfig {
+    std::string input;   // Video file (anything cv::VideoCapture opens)
+    std::string output;  // Timeline CSV ("" = <input>.leds.csv)
+    int threads = 0;     // Extraction workers (0 = all cores)
+};
+
+// Shm mode: raw frames from an external capture process via a shared-memory
+// frame ring (see utils/ShmFrameRing.h and tools/shm_frame_writer)
+struct ShmConfig {
+    std::string name = "/tvled-frames";  // POSIX shared memory object
+    int timeout_ms = 2000;  // Warn after this long without a frame, fail if the writer is gone
 };
 
 struct HyperHDRConfig {
@@ -83,6 +151,9 @@ struct PerformanceConfig {
     int target_fps = 0;  // 0 = max speed
     bool enable_parallel_processing = true;
     int parallel_chunk_size = 4;
+    int worker_threads = 0;      // Extraction thread pool size incl. the main thread (0 = one per core)
+    bool pin_threads = false;    // Bind pool threads to cores
+    int latency_report_frames = 300;  // Log per-stage latency percentiles every N frames (0 = off)
 };
 
 struct VisualizationConfig {
@@ -101,6 +172,15 @@ struct ColorSettingsConfig {
 struct ColorExtractionConfig {
     std::string mode = "edge_slices";  // "grid" or "edge_slices"
     std::string method = "dominant";   // "mean" or "dominant" - how to extract color from region
+    std::string engine = "mask";       // "mask", "integral", "label_map" or "tiled" (all mean only) - how regions are read
+    int tile_kib = 0;                  // Frame data per band of the tiled engine, 0 = half the L2 cache
+    int dominant_bits = 3;             // Dominant-color histogram bits per channel: 3, 4 or 5
+    int max_samples_per_led = 0;       // Pixels read per LED region, 0 = all (larger regions are subsampled)
+    std::string sampling = "blue_noise";  // "stride" or "blue_noise" - which pixels a capped region keeps
+    bool change_detection = false;     // Opt-in, lossy: re-extract only LEDs whose sampling-band blocks changed; changes under the threshold wait for the refresh
+    int change_block_size = 16;        // Change detection block edge in pixels
+    float change_threshold = 1.0f;     // Block mean change (levels) that counts as changed
+    int change_refresh_frames = 60;    // Re-extract every LED every n frames, 0 = never
     float horizontal_coverage_percent = 20.0f;  // 0-100
     float vertical_coverage_percent = 20.0f;    // 0-100
     int horizontal_slices = 10;  // Number of horizontal strips for top/bottom edges
@@ -141,7 +221,7 @@ public:
     bool validate() const;
     
     // Mode
-    std::string mode = "debug";  // "debug" or "live"
+    std::string mode = "debug";  // "debug", "live", "replay", "synthetic", "shm" or "batch"
     
     // Input/Output
     std::string input_image = "img2.png";
@@ -149,6 +229,10 @@ public:
     
     // Sub-configurations
     CameraConfig camera;
+    ReplayConfig replay;
+    SyntheticConfig synthetic;
+    ShmConfig shm;
+    BatchConfig batch;
     HyperHDRConfig hyperhdr;
     USBConfig usb;
     LEDLayoutConfig led_layout;
@@ -165,6 +249,10 @@ public:
     float offset_y = 0.0f;
     bool flip_horizontal = false;
     bool flip_vertical = false;
+    
+    // Apply camera scaling and flips to the LED geometry once instead of to
+    // every frame (live MJPEG only; yuv420 frames are already transformed by the ISP)
+    bool transform_geometry = false;
 };
 
 } // namespace TVLED
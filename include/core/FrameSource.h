@@ -1,10 +1,40 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace TVLED {
 
+// Counters a frame source keeps about itself (all cumulative)
+struct FrameSourceStats {
+    uint64_t frames_captured = 0;
+    uint64_t frames_dropped = 0;      // Captured but never handed out (newer frame won)
+    uint64_t frames_skipped = 0;      // Read from the stream but never decoded (drain to newest)
+    uint64_t buffer_allocations = 0;  // Frame buffers allocated, flat once capture is allocation-free
+    uint64_t restarts = 0;            // Camera process restarts
+};
+
+// Monotonic (steady_clock) timestamps of one frame on its way out of a source
+struct FrameTiming {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point captured;  // Sensor exposure (camera PTS when available, else arrival)
+    Clock::time_point received;  // Complete frame read from the stream
+    Clock::time_point decoded;   // Frame ready to be handed out
+    uint64_t sequence = 0;       // Frame number in the source's stream
+    // captured comes from the camera's PTS. These carry no absolute clock, so
+    // captured is anchored to the quickest frame's arrival: exact between
+    // frames, but capture -> received is jitter over that quickest frame.
+    bool sensor_timestamp = false;
+    
+    // All stages at once, for sources without a capture/decode split
+    void stampAll() {
+        captured = received = decoded = Clock::now();
+    }
+};
+
 class FrameSource {
 public:
     virtual ~FrameSource() = default;
@@ -12,8 +42,14 @@ public:
     // Initialize the frame source
     virtual bool initialize() = 0;
     
-    // Get the next frame
-    virtual bool getFrame(cv::Mat& frame) = 0;
+    // Get the next frame along with when it was captured, read and decoded
+    virtual bool getFrame(cv::Mat& frame, FrameTiming& timing) = 0;
+    
+    // Get the next frame when its timing is not needed
+    bool getFrame(cv::Mat& frame) {
+        FrameTiming timing;
+        return getFrame(frame, timing);
+    }
     
     // Release resources
     virtual void release() = 0;
@@ -23,6 +59,17 @@ public:
     
     // Check if source is ready
     virtual bool isReady() const = 0;
+    
+    // Hint which parts of the frame are actually read (frame coordinates).
+    // Sources may skip producing pixels outside them; default ignores the hint.
+    virtual void setRegionsOfInterest(const std::vector<cv::Rect>& regions) { (void)regions; }
+    
+    // Safe to call from any thread while the source is running
+    virtual FrameSourceStats getStats() const { return FrameSourceStats(); }
+    
+    // Make a getFrame() that is waiting, and every later one, return false
+    // soon. Only sets a flag, so it is safe from a signal handler.
+    virtual void interrupt() {}
 };
 
 } // namespace TVLED
@@ -11,7 +11,8 @@ public:
     ~ImageFrameSource() override = default;
     
     bool initialize() override;
-    bool getFrame(cv::Mat& frame) override;
+    using FrameSource::getFrame;
+    bool getFrame(cv::Mat& frame, FrameTiming& timing) override;
     void release() override;
     std::string getName() const override;
     bool isReady() const override;
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#ifdef HAVE_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+namespace TVLED {
+
+/**
+ * Decodes camera JPEGs straight to (roughly) the size processing wants.
+ *
+ * JPEG can be decoded at 1/2, 1/4 or 1/8 scale in the DCT domain, which skips
+ * most of the IDCT and color conversion work instead of decoding the full
+ * frame and throwing it away with cv::resize. The largest reduction whose
+ * output still covers the target size is used, so the result is either the
+ * exact target size or slightly larger (the caller resizes the remainder).
+ *
+ * With libjpeg-turbo available (HAVE_TURBOJPEG) a single TurboJPEG handle is
+ * kept for the lifetime of the decoder and fast DCT / fast upsampling can be
+ * enabled. Otherwise OpenCV's IMREAD_REDUCED_COLOR_* modes are used, which do
+ * the same DCT scaling through OpenCV's own libjpeg.
+ *
+ * When regions of interest are set and the libjpeg-turbo scanline API is
+ * available (HAVE_JPEG_ROI_DECODE), only the MCUs covering those regions are
+ * reconstructed (jpeg_crop_scanline / jpeg_skip_scanlines) and the rest of
+ * the output frame is left untouched.
+ *
+ * Not thread-safe: use one decoder per capture thread.
+ */
+class JpegDecoder {
+public:
+    JpegDecoder();
+    ~JpegDecoder();
+
+    JpegDecoder(const JpegDecoder&) = delete;
+    JpegDecoder& operator=(const JpegDecoder&) = delete;
+
+    // Desired output size (0x0 = decode at full resolution)
+    void setTargetSize(int width, int height);
+
+    // Trade a little accuracy for speed (TurboJPEG only, ignored otherwise)
+    void setFastDecode(bool enable) { fast_decode_ = enable; }
+
+    // Only decode these regions, given in coordinates of a frame of region_space
+    // size (empty size = coordinates of the decoded frame itself).
+    // No regions = decode whole frames.
+    void setRegionsOfInterest(const std::vector<cv::Rect>& regions, cv::Size region_space = cv::Size());
+
+    // Decode a JPEG into a BGR image, reusing frame's buffer when the size matches
+    bool decode(const uint8_t* data, size_t size, cv::Mat& frame);
+
+    // Scale denominator used for the last decoded frame (1, 2, 4 or 8)
+    int scaleDenominator() const { return scale_denom_; }
+
+    // Size of the last decoded frame (empty before the first decode)
+    cv::Size outputSize() const { return output_size_; }
+
+    // Whether the TurboJPEG path is compiled in and usable
+    bool usesTurboJPEG() const;
+
+    // Whether region-of-interest decoding is compiled in
+    static bool supportsRegionDecode();
+
+private:
+    // One decompression pass: a column range and the row ranges read within it
+    struct DecodePass {
+        int x0;
+        int x1;
+        std::vector<std::pair<int, int>> rows;  // [first, last) scanlines, ascending
+    };
+
+    // Largest reduction whose output still covers the target size
+    int chooseScaleDenominator(int jpeg_width, int jpeg_height) const;
+
+    // Map the regions of interest to decoded-frame MCUs and group them into passes
+    void planRegionPasses(int out_width, int out_height, int mcu_width, int mcu_height);
+
+#ifdef HAVE_JPEG_ROI_DECODE
+    struct LibjpegState;
+    bool decodeRegions(const uint8_t* data, size_t size, cv::Mat& frame);
+
+    std::unique_ptr<LibjpegState> libjpeg_;
+#endif
+#ifdef HAVE_TURBOJPEG
+    tjhandle handle_;
+#endif
+    int target_width_;
+    int target_height_;
+    bool fast_decode_;
+    int scale_denom_;
+    cv::Size output_size_;
+
+    std::vector<cv::Rect> regions_;
+    cv::Size region_space_;
+    std::vector<DecodePass> passes_;
+    cv::Size planned_size_;  // Decoded size passes_ were planned for
+};
+
+} // namespace TVLED
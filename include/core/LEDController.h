@@ -8,6 +8,7 @@
 #include "communication/LEDLayout.h"
 #include "communication/HyperHDRClient.h"
 #include "communication/USBController.h"
+#include "utils/LatencyHistogram.h"
 #include <memory>
 #include <atomic>
 
@@ -25,6 +26,16 @@ public:
     // Returns number of frames processed
     int run();
     
+    // Batch mode: extract every frame of config.batch.input in parallel and
+    // write the LED color timeline. Returns number of frames processed
+    int runBatch();
+    
+    // Sampling report: extract frames of the configured source once with the
+    // max_samples_per_led sampling and once from every pixel, and log how far
+    // the sampled colors are off. max_frames 0 = until the source runs out.
+    // Returns number of frames compared
+    int runSamplingReport(int max_frames);
+    
     // Stop the processing loop
     void stop();
     
@@ -37,6 +48,7 @@ private:
     bool setupBezierCurves();
     bool setupCoonsPatching(int imageWidth, int imageHeight);
     bool setupColorExtractor();
+    void configureColorExtractor(ColorExtractor& extractor) const;
     bool setupLEDLayout();
     bool setupHyperHDRClient();
     bool setupUSBController();
@@ -44,6 +56,17 @@ private:
     // Processing
     bool processFrame(const cv::Mat& frame, std::vector<cv::Vec3b>& colors);
     
+    // Native geometry: frame size the geometry is laid out in, and the mapping
+    // of polygons from there into the untransformed camera frame
+    cv::Size logicalFrameSize() const;
+    void mapPolygonsToNativeFrame(const cv::Size& logical, const cv::Size& native);
+    cv::Mat toLogicalFrame(const cv::Mat& frame) const;
+    
+    // Latency per pipeline stage, from the frame's capture time to the sinks
+    void recordLatency(const FrameTiming& timing, FrameTiming::Clock::time_point acquired,
+                       FrameTiming::Clock::time_point extracted, FrameTiming::Clock::time_point sent);
+    void reportLatency();
+    
     // Debug output
     void saveDebugBoundaries(const cv::Mat& frame);
     void saveColorGrid(const std::vector<cv::Vec3b>& colors);
@@ -60,6 +83,18 @@ private:
     BezierCurve top_bezier_, right_bezier_, bottom_bezier_, left_bezier_;
     
     std::vector<std::vector<cv::Point>> cell_polygons_;
+    bool native_geometry_;  // Frames arrive unscaled/unflipped, polygons are mapped instead
+    
+    struct LatencyStats {
+        LatencyHistogram pipe;     // Capture -> frame read from the source
+        LatencyHistogram decode;   // Read -> decoded
+        LatencyHistogram queue;    // Decoded -> picked up for processing
+        LatencyHistogram extract;  // Color extraction
+        LatencyHistogram send;     // HyperHDR / USB
+        LatencyHistogram total;    // Capture -> colors sent
+        bool sensor_timestamps = false;
+    };
+    LatencyStats latency_;
     
     std::atomic<bool> running_;
     bool initialized_;
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace TVLED {
+
+/**
+ * Tees the raw camera MJPEG stream to disk for later replay.
+ *
+ * A recording is two files:
+ *   <path>      the JPEG frames exactly as rpicam-vid sent them, concatenated
+ *               (a plain MJPEG stream, ffplay -f mjpeg can show it)
+ *   <path>.pts  capture time of every frame in milliseconds since the first,
+ *               one per line ("timecode format v2", same as rpicam-vid --save-pts)
+ *
+ * Frames are written without re-encoding so a replay decodes exactly the
+ * bytes the camera produced. Not thread-safe: write from the capture thread.
+ */
+class MJPEGRecorder {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    MJPEGRecorder();
+    ~MJPEGRecorder();
+
+    MJPEGRecorder(const MJPEGRecorder&) = delete;
+    MJPEGRecorder& operator=(const MJPEGRecorder&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return open_; }
+
+    // Append one complete JPEG captured at the given time.
+    // A write error closes the recording (the camera keeps running).
+    bool write(const uint8_t* data, size_t size, Clock::time_point captured);
+
+    uint64_t framesWritten() const { return frames_written_; }
+    uint64_t bytesWritten() const { return bytes_written_; }
+
+    // Timestamp file belonging to a recording
+    static std::string timestampPath(const std::string& path) { return path + ".pts"; }
+
+    // Load the per-frame timestamps (milliseconds) of a recording
+    static bool readTimestamps(const std::string& path, std::vector<double>& timestamps_ms);
+
+private:
+    std::ofstream stream_;
+    std::ofstream timestamps_;
+    std::string path_;
+    bool open_;
+    Clock::time_point first_frame_;
+    uint64_t frames_written_;
+    uint64_t bytes_written_;
+};
+
+} // namespace TVLED
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace TVLED {
+
+/**
+ * Splits a raw MJPEG byte stream (concatenated JPEG images) into complete
+ * JPEG frames without copying them.
+ *
+ * Data is read straight into a reusable buffer (see writeBuffer/commit) and
+ * SOI (0xFF 0xD8) / EOI (0xFF 0xD9) markers are located with memchr, which is
+ * vectorized by the C library on both ARM and x86. Consumed bytes are only
+ * reclaimed (by moving the unconsumed tail to the front) when more space is
+ * requested, so a span returned by nextFrame() stays valid until the next call
+ * to writeBuffer() or reset().
+ */
+class MJPEGStreamSplitter {
+public:
+    explicit MJPEGStreamSplitter(size_t initial_capacity = 1 << 20);
+
+    // Get a writable region of at least min_bytes at the end of the buffer.
+    // Invalidates any span previously returned by nextFrame().
+    uint8_t* writeBuffer(size_t min_bytes);
+
+    // Mark bytes written into writeBuffer() as valid stream data
+    void commit(size_t bytes);
+
+    // Find the next complete JPEG in the buffered data.
+    // Returns false if more data is needed.
+    bool nextFrame(const uint8_t*& data, size_t& size);
+
+    // Drop all buffered data and scanning state (keeps capacity)
+    void reset();
+
+    // Number of buffered bytes not yet consumed
+    size_t pending() const { return write_pos_ - read_pos_; }
+    size_t capacity() const { return buffer_.size(); }
+
+private:
+    static constexpr size_t kNoFrame = static_cast<size_t>(-1);
+
+    // Find 0xFF <marker> in [from, write_pos_), returns offset of 0xFF or kNoFrame.
+    // On failure, *resume receives the offset scanning should restart from.
+    size_t findMarker(size_t from, uint8_t marker, size_t* resume) const;
+
+    std::vector<uint8_t> buffer_;
+    size_t read_pos_;     // Start of unconsumed data
+    size_t write_pos_;    // End of valid data
+    size_t scan_pos_;     // Where the next marker search starts
+    size_t frame_start_;  // Offset of the current SOI, or kNoFrame
+};
+
+} // namespace TVLED
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "core/CameraFrameSource.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace TVLED {
+
+/**
+ * Plays back a recording made with camera.record_path (see MJPEGRecorder).
+ *
+ * The recorded JPEGs go through exactly the same decode path as live camera
+ * frames (DCT scaling, ROI decode, resize, flip), so the whole pipeline can be
+ * benchmarked on real content without a camera. Frames are either paced by
+ * their recorded capture timestamps (real-time) or delivered as fast as they
+ * decode. Without a .pts file frames are paced at the configured fps.
+ */
+class ReplayFrameSource : public CameraFrameSource {
+public:
+    ReplayFrameSource(const std::string& path, bool realtime, bool loop,
+                      int width, int height, int fps,
+                      bool enable_scaling = true, int scaled_width = 960, int scaled_height = 540,
+                      bool flip_horizontal = false, bool flip_vertical = false,
+                      bool dct_scaling = true, bool fast_decode = false,
+                      bool native_output = false);
+    
+    bool initialize() override;
+    using FrameSource::getFrame;
+    bool getFrame(cv::Mat& frame, FrameTiming& timing) override;
+    std::string getName() const override;
+
+protected:
+    int openStream() override;
+    bool onEndOfStream(int fd) override;
+    bool needsWarmup() const override { return false; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    
+    // Playback time of a frame relative to the start of the recording
+    double frameTimeMs(size_t index) const;
+    
+    std::string path_;
+    bool realtime_;
+    bool loop_;
+    int fps_;
+    
+    // Wall-clock time a frame of the current pass is due
+    Clock::time_point dueTime(size_t index) const;
+    
+    // Sleep until due in short slices, false once interrupt() was called
+    bool waitUntil(Clock::time_point due) const;
+    
+    std::vector<double> timestamps_ms_;
+    size_t frame_index_;   // Stream position, within the current pass, of the next frame
+    uint64_t pass_first_sequence_;  // Stream sequence number of the current pass's first frame
+    uint64_t frames_played_;
+    int loops_;
+    bool rewound_;         // Stream wrapped around since the last frame
+    Clock::time_point playback_start_;
+};
+
+} // namespace TVLED
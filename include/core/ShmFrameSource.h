@@ -0,0 +1,67 @@
+#pragma once
+
+#include "core/FrameSource.h"
+#include "utils/ShmFrameRing.h"
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+namespace TVLED {
+
+/**
+ * Raw frames from an external capture process through a POSIX shared-memory
+ * ring (layout and protocol in utils/ShmFrameRing.h).
+ *
+ * Frames are handed out in place: the returned cv::Mat points straight into
+ * the shared slot, so there is no copy and no encode/decode round trip. The
+ * writer keeps going meanwhile, and a slot is only reused after slot_count - 1
+ * newer frames, so the ring must be deep enough to cover one processing pass.
+ * When the writer laps a frame that is still in use this is detected on the
+ * next getFrame() and counted as an overrun.
+ *
+ * The newest published frame is always taken, older ones count as dropped.
+ * Waiting for the next frame blocks on a futex in the ring header, in short
+ * slices so interrupt() ends a wait on a paused writer.
+ */
+class ShmFrameSource : public FrameSource {
+public:
+    explicit ShmFrameSource(const std::string& name, int timeout_ms = 2000);
+    ~ShmFrameSource() override;
+
+    ShmFrameSource(const ShmFrameSource&) = delete;
+    ShmFrameSource& operator=(const ShmFrameSource&) = delete;
+
+    bool initialize() override;
+    using FrameSource::getFrame;
+    bool getFrame(cv::Mat& frame, FrameTiming& timing) override;
+    void release() override;
+    std::string getName() const override;
+    bool isReady() const override;
+    FrameSourceStats getStats() const override;
+    void interrupt() override;
+
+    // Frames are I420 (single channel, rows = height * 3/2) rather than BGR
+    bool isI420() const;
+
+    // Image size of the ring's frames (empty before initialize())
+    cv::Size frameSize() const;
+
+private:
+    bool writerAlive() const;
+    void checkOverrun();
+
+    std::string name_;
+    int timeout_ms_;
+    std::atomic<bool> interrupted_;
+
+    void* mapping_;
+    size_t mapping_size_;
+    ShmFrameRing::Header* header_;
+
+    uint64_t last_frame_;      // Frame number last handed out (0 = none yet)
+    uint64_t overruns_;        // Frames overwritten while still in use
+    std::atomic<uint64_t> frames_captured_;
+    std::atomic<uint64_t> frames_dropped_;
+};
+
+} // namespace TVLED
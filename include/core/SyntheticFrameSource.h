@@ -0,0 +1,73 @@
+#pragma once
+
+#include "core/FrameSource.h"
+#include "utils/FramePool.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace TVLED {
+
+/**
+ * Procedurally generated BGR frames for benchmarks: any resolution, any frame
+ * rate, no camera or image files needed.
+ *
+ * Patterns:
+ *   gradient   color gradient scrolling horizontally
+ *   bars       moving vertical color bars (hard edges between LED regions)
+ *   noise      uniform random noise (worst case for anything content dependent)
+ *   letterbox  scrolling gradient inside 2.39:1 black bars
+ *   static     the same gradient every frame
+ *
+ * Frames are rendered into pooled buffers (see FramePool), so generating
+ * allocates nothing once the pipeline has warmed up. Noise uses a fixed seed
+ * so runs are reproducible.
+ */
+class SyntheticFrameSource : public FrameSource {
+public:
+    SyntheticFrameSource(const std::string& pattern, int width, int height, int fps = 0);
+    ~SyntheticFrameSource() override = default;
+    
+    bool initialize() override;
+    using FrameSource::getFrame;
+    bool getFrame(cv::Mat& frame, FrameTiming& timing) override;
+    void release() override;
+    std::string getName() const override;
+    bool isReady() const override;
+    FrameSourceStats getStats() const override;
+    
+    static bool isValidPattern(const std::string& pattern);
+
+private:
+    enum class Pattern {
+        Gradient,
+        Bars,
+        Noise,
+        Letterbox,
+        Static
+    };
+    
+    using Clock = std::chrono::steady_clock;
+    
+    void renderGradient(cv::Mat& frame, int offset);
+    void renderBars(cv::Mat& frame, int offset);
+    void renderLetterbox(cv::Mat& frame, int offset);
+    
+    std::string pattern_name_;
+    Pattern pattern_;
+    int width_;
+    int height_;
+    int fps_;  // 0 = as fast as possible
+    bool initialized_;
+    
+    FramePool frame_pool_;
+    cv::Mat static_frame_;
+    std::vector<cv::Vec3b> row_;  // One rendered row, copied down the frame
+    cv::RNG rng_;
+    
+    std::atomic<uint64_t> frame_index_;
+    Clock::time_point next_frame_time_;
+};
+
+} // namespace TVLED
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "core/FrameSource.h"
+#include "utils/TripleBuffer.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace TVLED {
+
+/**
+ * Runs another frame source on a dedicated capture thread.
+ *
+ * The capture thread reads and decodes frames continuously into a lock-free
+ * triple buffer, so capture/decode overlaps with extraction and sending.
+ * getFrame() always returns the newest decoded frame; frames that were never
+ * picked up are dropped instead of queueing up in the camera pipe.
+ *
+ * The frame returned by getFrame() stays valid until the next getFrame() call.
+ */
+class ThreadedFrameSource : public FrameSource {
+public:
+    explicit ThreadedFrameSource(std::unique_ptr<FrameSource> source);
+    ~ThreadedFrameSource() override;
+
+    bool initialize() override;
+    using FrameSource::getFrame;
+    bool getFrame(cv::Mat& frame, FrameTiming& timing) override;
+    void release() override;
+    std::string getName() const override;
+    bool isReady() const override;
+    void setRegionsOfInterest(const std::vector<cv::Rect>& regions) override;
+    FrameSourceStats getStats() const override;
+    void interrupt() override;
+
+private:
+    // A frame travels through the triple buffer together with its timing
+    struct TimedFrame {
+        cv::Mat frame;
+        FrameTiming timing;
+    };
+    
+    void captureLoop();
+    void stopCaptureThread();
+
+    std::unique_ptr<FrameSource> source_;
+    TripleBuffer<TimedFrame> buffer_;
+
+    std::thread capture_thread_;
+    std::atomic<bool> running_;
+    std::atomic<bool> failed_;
+    std::atomic<bool> interrupted_;
+
+    // Only used to sleep until a frame is published, never held while copying frames
+    std::mutex wait_mutex_;
+    std::condition_variable frame_ready_;
+
+    std::atomic<uint64_t> frames_captured_;
+    std::atomic<uint64_t> frames_dropped_;
+};
+
+} // namespace TVLED
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "processing/SpanKernels.h"
+#include "utils/ThreadPool.h"
 #include <opencv2/opencv.hpp>
+#include <memory>
 #include <vector>
 
 namespace TVLED {
@@ -10,9 +13,6 @@ struct CornerGamma {
     double gamma_red = 2.2;
     double gamma_green = 2.2;
     double gamma_blue = 2.2;
-    std::vector<uchar> lut_red;
-    std::vector<uchar> lut_green;
-    std::vector<uchar> lut_blue;
 };
 
 // Structure to hold LED count information for edges
@@ -27,16 +27,37 @@ struct LEDCounts {
     }
 };
 
+// Horizontal run of region pixels [x0, x1) on image row y
+struct RowSpan {
+    int y;
+    int x0;
+    int x1;
+};
+
+// Pixel layout of frames passed to extractColors()
+enum class PixelFormat {
+    BGR,   // CV_8UC3, OpenCV default
+    I420   // CV_8UC1 with rows = height * 3/2: Y plane, then U and V at half resolution
+};
+
 class ColorExtractor {
 public:
-    ColorExtractor() : enable_parallel_(true), masks_precomputed_(false), method_("mean"),
+    ColorExtractor() : enable_parallel_(true), masks_precomputed_(false), method_("mean"), dominant_bits_(3),
+                       engine_("mask"), max_samples_per_led_(0), sampling_("stride"),
+                       pixel_format_(PixelFormat::BGR), yuv_rec709_(false),
+                       region_kernel_(nullptr), frame_kernel_(nullptr),
+                       bgr_isa_(SpanKernels::bestIsa()), accumulate_bgr_(SpanKernels::bgrKernel(bgr_isa_)),
+                       prefix_entries_(0), tile_bytes_(0), band_sums_stride_(0),
+                       change_detection_(false), change_block_size_(16), change_threshold_(1.0),
+                       change_refresh_frames_(60), frames_since_refresh_(0),
                        gamma_enabled_(false) {
         // Initialize default gamma for backward compatibility
         corner_gamma_top_left_.gamma_red = corner_gamma_top_left_.gamma_green = corner_gamma_top_left_.gamma_blue = 2.2;
         corner_gamma_top_center_ = corner_gamma_top_right_ = corner_gamma_right_center_ = 
         corner_gamma_bottom_right_ = corner_gamma_bottom_center_ = corner_gamma_bottom_left_ = 
         corner_gamma_left_center_ = corner_gamma_top_left_;
-        buildAllGammaLUTs();
+        buildLEDGammaLUTs();
+        resolveKernels();
     }
     
     // Extract colors from regions defined by polygons
@@ -44,25 +65,125 @@ public:
     std::vector<cv::Vec3b> extractColors(const cv::Mat& frame,
                                          const std::vector<std::vector<cv::Point>>& polygons);
     
-    // Pre-compute masks for polygons (optimization: avoid per-frame mask creation)
+    // Pre-compute the row spans of every polygon (one contiguous array), so
+    // extraction only touches covered pixels and never reads a mask.
     // Call this once after polygons are created with known frame dimensions
     void precomputeMasks(const std::vector<std::vector<cv::Point>>& polygons,
                         int frame_width, int frame_height);
     
-    // Clear pre-computed masks (call when polygons change)
+    // Bounding boxes of the pre-computed regions, i.e. every pixel extraction reads
+    const std::vector<cv::Rect>& getCachedBoundingBoxes() const { return cached_bboxes_; }
+    
+    // Pixels read per LED after sampling (parallel to the bounding boxes)
+    const std::vector<int>& getCachedPixelCounts() const { return led_pixel_counts_; }
+    
+    // Clear pre-computed regions (call when polygons change)
     void clearMasks() {
-        cached_masks_.clear();
         cached_bboxes_.clear();
+        cached_spans_.clear();
+        led_span_begin_.clear();
+        led_pixel_counts_.clear();
+        prefix_segments_.clear();
+        span_lookups_.clear();
+        prefix_entries_ = 0;
+        label_runs_.clear();
+        label_row_begin_.clear();
+        label_row_pixels_.clear();
+        label_overflow_.clear();
+        tile_entries_.clear();
+        tile_band_begin_.clear();
+        tile_band_rows_.clear();
+        led_chunk_begin_.clear();
+        segment_chunk_begin_.clear();
+        label_band_begin_.clear();
+        change_blocks_.clear();
+        change_led_block_begin_.clear();
+        change_led_blocks_.clear();
+        last_colors_.clear();
         masks_precomputed_ = false;
     }
     
-    void setParallelProcessing(bool enable) { enable_parallel_ = enable; }
+    // Spread extraction over a persistent thread pool. threads counts the
+    // calling thread (0 = one per core); pin_threads binds pool threads to cores.
+    // The pool is kept when disabling, so re-enabling is free
+    void setParallelProcessing(bool enable, int threads = 0, bool pin_threads = false);
     bool isParallelProcessingEnabled() const { return enable_parallel_; }
     
+    // Incremental extraction for mostly static content. The sampling band is
+    // cut into block_size blocks whose channel sums are taken every frame, and
+    // only LEDs touching a block whose mean moved by more than threshold levels
+    // since they were last extracted are extracted again; the rest keep their
+    // previous color. Every refresh_frames frames (0 = never) all LEDs are
+    // extracted. Needs frames in order from one caller at a time (not batch mode)
+    void setChangeDetection(bool enable, int block_size = 16, double threshold = 1.0, int refresh_frames = 60);
+    bool isChangeDetectionEnabled() const { return change_detection_; }
+    
+    // LED extractions done and skipped by change detection so far
+    struct ChangeStats {
+        uint64_t frames = 0;
+        uint64_t leds = 0;
+        uint64_t skipped = 0;
+        
+        double skipRate() const { return leds ? static_cast<double>(skipped) / leds : 0.0; }
+    };
+    const ChangeStats& getChangeStats() const { return change_stats_; }
+    
     // Set color extraction method: "mean" or "dominant"
-    void setMethod(const std::string& method) { method_ = method; }
+    void setMethod(const std::string& method) {
+        method_ = method;
+        resolveKernels();
+    }
     std::string getMethod() const { return method_; }
     
+    // Quantization of the dominant-color histogram: 3, 4 or 5 bits per channel
+    // (512, 4096 or 32768 bins). Finer bins follow small color areas more closely
+    void setDominantBits(int bits) {
+        dominant_bits_ = bits;
+        last_colors_.clear();
+    }
+    int getDominantBits() const { return dominant_bits_; }
+    
+    // Set extraction engine: "mask" (per-LED span loops), "integral" (per-row
+    // prefix sums over the sampling band), "label_map" (one top-to-bottom
+    // pass over per-row label runs) or "tiled" (per-LED span loops one
+    // cache-sized row band at a time). All but "mask" support the mean method
+    // only. Takes effect at the next precomputeMasks()
+    void setEngine(const std::string& engine) {
+        engine_ = engine;
+        resolveKernels();
+    }
+    std::string getEngine() const { return engine_; }
+    
+    // Bytes of frame data one band of the tiled engine may touch
+    // (0 = half the L2 cache). Takes effect at the next precomputeMasks()
+    void setTileBytes(size_t bytes) { tile_bytes_ = bytes; }
+    
+    // Cap on the pixels read per LED (0 = every covered pixel). Larger regions
+    // keep a fixed subset, one pixel per cell of a grid laid over the region:
+    // the pixel nearest the cell center ("stride") or a hashed pick within the
+    // cell ("blue_noise", a jittered grid without the aliasing of a regular
+    // one). Takes effect at the next precomputeMasks()
+    void setSampling(int max_samples_per_led, const std::string& pattern) {
+        max_samples_per_led_ = max_samples_per_led;
+        sampling_ = pattern;
+    }
+    int getMaxSamplesPerLED() const { return max_samples_per_led_; }
+    std::string getSampling() const { return sampling_; }
+    
+    // Set frame pixel format. For I420 the per-LED Y/U/V averages are converted
+    // to RGB (BT.601 limited range, or BT.709 when rec709 is set)
+    void setPixelFormat(PixelFormat format, bool rec709 = false) {
+        pixel_format_ = format;
+        yuv_rec709_ = rec709;
+        resolveKernels();
+    }
+    PixelFormat getPixelFormat() const { return pixel_format_; }
+    
+    // Image height of a frame in the configured pixel format
+    int imageHeight(const cv::Mat& frame) const {
+        return pixel_format_ == PixelFormat::I420 ? frame.rows * 2 / 3 : frame.rows;
+    }
+    
     // Legacy gamma correction (applies to all control points)
     void setGammaCorrection(bool enabled, double gamma_r, double gamma_g, double gamma_b) {
         gamma_enabled_ = enabled;
@@ -78,7 +199,8 @@ public:
         corner_gamma_right_center_.gamma_blue = corner_gamma_bottom_right_.gamma_blue = corner_gamma_bottom_center_.gamma_blue =
         corner_gamma_bottom_left_.gamma_blue = corner_gamma_left_center_.gamma_blue = gamma_b;
         
-        buildAllGammaLUTs();
+        buildLEDGammaLUTs();
+        resolveKernels();
     }
     
     // 8-point gamma correction (4 corners + 4 edge centers)
@@ -124,7 +246,8 @@ public:
         corner_gamma_left_center_.gamma_green = lc_g;
         corner_gamma_left_center_.gamma_blue = lc_b;
         
-        buildAllGammaLUTs();
+        buildLEDGammaLUTs();
+        resolveKernels();
     }
     
     // Set LED layout for corner-based gamma calculation
@@ -133,39 +256,131 @@ public:
         led_counts_.bottom = bottom;
         led_counts_.left = left;
         led_counts_.right = right;
+        buildLEDGammaLUTs();
     }
     
-    void enableGammaCorrection(bool enabled) { gamma_enabled_ = enabled; }
+    void enableGammaCorrection(bool enabled) {
+        gamma_enabled_ = enabled;
+        resolveKernels();
+    }
     bool isGammaCorrectionEnabled() const { return gamma_enabled_; }
 
 private:
+    // Row spans of one region: a slice of the contiguous span array
+    struct SpanList {
+        const RowSpan* spans = nullptr;
+        size_t count = 0;
+        int pixels = 0;  // Sum of span widths
+    };
+    
+    SpanList ledSpans(size_t led) const {
+        SpanList region;
+        region.spans = cached_spans_.data() + led_span_begin_[led];
+        region.count = led_span_begin_[led + 1] - led_span_begin_[led];
+        region.pixels = led_pixel_counts_[led];
+        return region;
+    }
+    
+    // Append the runs of set pixels of a mask placed at bbox, returns their pixel count
+    static int appendMaskSpans(const cv::Mat& mask, const cv::Rect& bbox, std::vector<RowSpan>& spans);
+    
+    // Replace the region spans from spans[first] on (pixels in total) by at
+    // most max_samples_per_led_ sample pixels; returns the sample count
+    int sampleSpans(std::vector<RowSpan>& spans, size_t first, int pixels) const;
+    
     // Extract color from a single polygon region
     cv::Vec3b extractSingleColor(const cv::Mat& frame,
                                  const std::vector<cv::Point>& polygon,
                                  const cv::Rect& bbox,
                                  int led_index = -1);
     
-    // Extract color using pre-computed mask (faster)
-    cv::Vec3b extractSingleColorWithMask(const cv::Mat& frame,
-                                        const cv::Mat& mask,
-                                        const cv::Rect& bbox,
-                                        int led_index = -1);
+    // Mean color (average of all pixels), RGB before gamma
+    template <PixelFormat Format>
+    cv::Vec3b meanColor(const cv::Mat& frame, const SpanList& region) const;
+    
+    // Average color of the fullest histogram bin, RGB before gamma. I420
+    // frames are quantized in YUV space, only the winning bin is converted
+    template <PixelFormat Format>
+    cv::Vec3b dominantColor(const cv::Mat& frame, const SpanList& region) const;
+    
+    // Fullest bin of a dominant-color histogram (channel sums in key order)
+    struct DominantBin {
+        uint32_t count;
+        uint32_t sum_hi;
+        uint32_t sum_mid;
+        uint32_t sum_lo;
+    };
+    template <typename ForEachPixel>
+    static DominantBin findDominantBin(int bits, ForEachPixel for_each_pixel);
+    
+    // Kernels specialized at compile time for method, pixel format and gamma.
+    // resolveKernels() picks the instantiations whenever one of those settings
+    // changes, so the per-LED path has no string compares or mode branches
+    enum class Method { Mean, Dominant };
+    using RegionKernel = cv::Vec3b (ColorExtractor::*)(const cv::Mat&, const SpanList&, int);
+    using FrameKernel = std::vector<cv::Vec3b> (ColorExtractor::*)(const cv::Mat&);
+    
+    template <Method M, PixelFormat Format, bool Gamma>
+    cv::Vec3b extractRegion(const cv::Mat& frame, const SpanList& region, int led_index);
+    void resolveKernels();
+    
+    // Mean color of count pixels from their channel sums (B, G, R or Y, U, V)
+    // as RGB, gamma-corrected for led_index when Gamma is set. The span loops
+    // and every engine resolve through here, so all produce identical colors
+    template <PixelFormat Format, bool Gamma>
+    cv::Vec3b meanFromSums(uint32_t sum0, uint32_t sum1, uint32_t sum2, int count, int led_index) const;
+    template <PixelFormat Format, bool Gamma>
+    std::vector<cv::Vec3b> resolveMeanColors(const uint32_t* sums) const;
+    
+    // Run run_band(band, sums) for bands [0, bands) and return the LED sums
+    // (3 per LED) they added up. With the pool every worker adds into its own
+    // slice of band_sums_, merged afterwards
+    template <typename RunBand>
+    const uint32_t* parallelBandSums(size_t bands, RunBand run_band);
+    
+    // Integral engine: merge the spans of each row into prefix segments
+    // and map every span onto its segment's prefix sums
+    void buildIntegralLayout(int frame_height);
+    template <PixelFormat Format, bool Gamma>
+    std::vector<cv::Vec3b> extractColorsIntegral(const cv::Mat& frame);
+    
+    // Label-map engine: cut every row into runs covered by the same set of
+    // LEDs, then stream the frame once and add each run's sums to its LEDs
+    void buildLabelMap(int frame_height);
+    template <PixelFormat Format, bool Gamma>
+    std::vector<cv::Vec3b> extractColorsLabelMap(const cv::Mat& frame);
+    
+    // Tiled engine: cut the rows into bands that fit the cache, and list per
+    // band the spans of every LED intersecting it; bands are then extracted
+    // one after the other into partial sums per LED
+    void buildTiles(int frame_height);
+    template <PixelFormat Format, bool Gamma>
+    std::vector<cv::Vec3b> extractColorsTiled(const cv::Mat& frame);
+    
+    // Split LEDs, prefix segments and label-map rows into chunks of about
+    // equal pixel counts, a few per pool worker
+    void buildWorkChunks();
+    bool runParallel() const { return enable_parallel_ && pool_ && pool_->size() > 1; }
+    
+    // Extract the pre-computed regions whose dirty flag is set (all of them
+    // when dirty is null) into colors
+    void extractRegions(const cv::Mat& frame, std::vector<cv::Vec3b>& colors, const std::vector<uchar>* dirty);
     
-    // Extract mean color (average of all pixels)
-    cv::Vec3b extractMeanColor(const cv::Mat& frame,
-                               const cv::Mat& mask,
-                               const cv::Rect& bbox,
-                               int led_index = -1);
+    // Change detection: blocks covering the regions and each LED's blocks,
+    // then per frame the block sums and the LEDs that need extracting
+    void buildChangeBlocks();
+    void sumChangeBlocks(const cv::Mat& frame, uint32_t* sums) const;
+    std::vector<cv::Vec3b> extractChangedColors(const cv::Mat& frame);
     
-    // Extract dominant color using k-means clustering
-    cv::Vec3b extractDominantColor(const cv::Mat& frame,
-                                   const cv::Mat& mask,
-                                   const cv::Rect& bbox,
-                                   int led_index = -1);
+    // Convert an averaged Y/U/V triple to RGB
+    cv::Vec3b yuvToRGB(double y, double u, double v) const;
     
     // Gamma correction utilities
-    void buildAllGammaLUTs();
-    void buildGammaLUT(CornerGamma& corner_gamma);
+    // One 3x256 table per LED of the layout, built from the blended gammas
+    // whenever the layout or a gamma changes; the hot path is three lookups
+    void buildLEDGammaLUTs();
+    static uchar gammaCorrect(uchar value, double gamma);
+    // Gamma-correct one LED's color (callers check whether gamma is enabled)
     cv::Vec3b applyGammaCorrection(const cv::Vec3b& color, int led_index) const;
     
     // Calculate blended gamma based on distance from 4 corners
@@ -179,14 +394,104 @@ private:
     bool enable_parallel_;
     bool masks_precomputed_;
     std::string method_;  // "mean" or "dominant"
-    std::vector<cv::Mat> cached_masks_;
+    int dominant_bits_;
+    std::string engine_;  // "mask", "integral", "label_map" or "tiled"
+    int max_samples_per_led_;  // 0 = all pixels
+    std::string sampling_;     // "stride" or "blue_noise"
+    PixelFormat pixel_format_;
+    bool yuv_rec709_;
+    
+    RegionKernel region_kernel_;  // Per-LED extraction over spans
+    FrameKernel frame_kernel_;    // Whole-frame engine (integral, label map, tiled), nullptr = per LED
+    
+    // BGR span kernel picked for this CPU at construction
+    SpanKernels::Isa bgr_isa_;
+    SpanKernels::AccumulateBGR accumulate_bgr_;
+    
     std::vector<cv::Rect> cached_bboxes_;
     
+    // Region row spans: all LEDs back to back, LED i owns
+    // cached_spans_[led_span_begin_[i] .. led_span_begin_[i + 1])
+    std::vector<RowSpan> cached_spans_;
+    std::vector<size_t> led_span_begin_;
+    std::vector<int> led_pixel_counts_;
+    
+    // Integral engine layout (built by precomputeMasks)
+    struct PrefixSegment {
+        int y;
+        int x0;
+        int x1;
+        size_t offset;  // First prefix entry; a segment has x1 - x0 + 1 entries
+    };
+    struct SpanLookup {
+        size_t begin;  // Prefix entry before the span's first pixel
+        size_t end;    // Prefix entry after its last pixel
+    };
+    std::vector<PrefixSegment> prefix_segments_;
+    std::vector<SpanLookup> span_lookups_;  // Parallel to cached_spans_
+    size_t prefix_entries_;
+    
+    // Label-map engine layout (built by precomputeMasks). Runs of row y are
+    // label_runs_[label_row_begin_[y] .. label_row_begin_[y + 1]), sorted by x
+    struct LabelRun {
+        int x0;
+        int x1;
+        uint32_t label;  // LED index, or first label_overflow_ entry when count > 1
+        uint32_t count;  // Number of LEDs whose regions share these pixels
+    };
+    std::vector<LabelRun> label_runs_;
+    std::vector<size_t> label_row_begin_;
+    std::vector<size_t> label_row_pixels_;  // Run pixels above row y, for balanced row bands
+    std::vector<uint32_t> label_overflow_;  // LED lists of shared runs
+    
+    // Tiled engine layout (built by precomputeMasks). Band b covers rows
+    // [tile_band_rows_[b], tile_band_rows_[b + 1]), its work is
+    // tile_entries_[tile_band_begin_[b] .. tile_band_begin_[b + 1])
+    struct TileEntry {
+        uint32_t led;
+        uint32_t span_begin;  // LED's spans in the band: cached_spans_[span_begin .. span_end)
+        uint32_t span_end;
+    };
+    size_t tile_bytes_;
+    std::vector<TileEntry> tile_entries_;
+    std::vector<size_t> tile_band_begin_;
+    std::vector<int> tile_band_rows_;
+    
+    // Parallel extraction: chunk c covers items [begin[c], begin[c + 1])
+    std::unique_ptr<ThreadPool> pool_;
+    std::vector<size_t> led_chunk_begin_;
+    std::vector<size_t> segment_chunk_begin_;
+    std::vector<size_t> label_band_begin_;  // Row bands of the label map
+    std::vector<uint32_t> band_sums_;       // Per-worker LED sums, sized by buildWorkChunks()
+    size_t band_sums_stride_;
+    
+    // Change detection. Blocks are the block-grid cells any region touches,
+    // LED i's blocks are change_led_blocks_[change_led_block_begin_[i] .. [i + 1])
+    bool change_detection_;
+    int change_block_size_;
+    double change_threshold_;
+    int change_refresh_frames_;
+    cv::Size mask_frame_size_;
+    std::vector<cv::Rect> change_blocks_;
+    std::vector<size_t> change_led_block_begin_;
+    std::vector<uint32_t> change_led_blocks_;
+    std::vector<uint32_t> change_block_sums_;  // 3 per block, as of the last extraction of its LEDs
+    std::vector<uint32_t> change_frame_sums_;  // Scratch: this frame's block sums
+    std::vector<uchar> change_block_dirty_;
+    std::vector<uchar> change_led_dirty_;
+    std::vector<cv::Vec3b> last_colors_;       // Previous frame's colors, empty = none yet
+    int frames_since_refresh_;
+    ChangeStats change_stats_;
+    
     // Gamma correction settings
     bool gamma_enabled_;
     LEDCounts led_counts_;
     
-    // 8-point gamma settings with LUTs (4 corners + 4 edge centers)
+    // Per-LED gamma LUTs, back to back: LED i's red, green and blue tables
+    // start at (i * 3 + channel) * 256
+    std::vector<uchar> led_gamma_luts_;
+    
+    // 8-point gamma settings (4 corners + 4 edge centers)
     CornerGamma corner_gamma_top_left_;
     CornerGamma corner_gamma_top_center_;
     CornerGamma corner_gamma_top_right_;
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <initializer_list>
+
+// NEON SIMD support for ARM processors
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define USE_NEON_SIMD 1
+#endif
+
+// x86 kernels are compiled per function with target attributes and picked at
+// runtime, so one binary runs on any x86 CPU and still uses AVX2 where present
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define USE_X86_SIMD 1
+#endif
+
+namespace TVLED {
+
+/**
+ * Row-span accumulation kernels used by ColorExtractor.
+ *
+ * A span is a run [x0, x1) of region pixels on one row, so every loaded pixel
+ * counts and no kernel needs a mask. All kernels return the exact integer
+ * channel sums, i.e. results are bit-identical to the scalar loop whichever
+ * kernel runs (tools/kernel_check.cpp verifies this on the target machine).
+ */
+namespace SpanKernels {
+
+enum class Isa {
+    Scalar,
+    NEON,
+    SSE41,
+    AVX2
+};
+
+// Sums the BGR pixels [x0, x1) of row into the three channel accumulators
+using AccumulateBGR = void (*)(const cv::Vec3b* row, int x0, int x1,
+                               uint32_t& sum_b, uint32_t& sum_g, uint32_t& sum_r);
+
+inline const char* isaName(Isa isa) {
+    switch (isa) {
+        case Isa::NEON: return "NEON";
+        case Isa::SSE41: return "SSE4.1";
+        case Isa::AVX2: return "AVX2";
+        default: return "scalar";
+    }
+}
+
+inline void accumulateBGRScalar(const cv::Vec3b* row, int x0, int x1,
+                                uint32_t& sum_b, uint32_t& sum_g, uint32_t& sum_r) {
+    for (int x = x0; x < x1; x++) {
+        const cv::Vec3b& pixel = row[x];
+        sum_b += pixel[0];
+        sum_g += pixel[1];
+        sum_r += pixel[2];
+    }
+}
+
+#ifdef USE_NEON_SIMD
+// Horizontal sum of four 32-bit lanes (pairwise adds, works on ARMv7 and AArch64)
+inline uint32_t horizontalSumNEON(uint32x4_t v) {
+    uint32x2_t pair = vadd_u32(vget_low_u32(v), vget_high_u32(v));
+    return vget_lane_u32(vpadd_u32(pair, pair), 0);
+}
+
+inline void accumulateBGRNEON(const cv::Vec3b* row, int x0, int x1,
+                              uint32_t& sum_b, uint32_t& sum_g, uint32_t& sum_r) {
+    int x = x0;
+
+    // 16 pixels per iteration, deinterleaved by vld3q and pairwise-widened into 32-bit lanes
+    uint32x4_t acc_b = vdupq_n_u32(0);
+    uint32x4_t acc_g = vdupq_n_u32(0);
+    uint32x4_t acc_r = vdupq_n_u32(0);
+
+    for (; x + 15 < x1; x += 16) {
+        uint8x16x3_t pixels = vld3q_u8(reinterpret_cast<const uint8_t*>(row + x));
+        acc_b = vpadalq_u16(acc_b, vpaddlq_u8(pixels.val[0]));
+        acc_g = vpadalq_u16(acc_g, vpaddlq_u8(pixels.val[1]));
+        acc_r = vpadalq_u16(acc_r, vpaddlq_u8(pixels.val[2]));
+    }
+
+    sum_b += horizontalSumNEON(acc_b);
+    sum_g += horizontalSumNEON(acc_g);
+    sum_r += horizontalSumNEON(acc_r);
+
+    accumulateBGRScalar(row, x, x1, sum_b, sum_g, sum_r);
+}
+#endif
+
+#ifdef USE_X86_SIMD
+// Interleaved BGR has no x86 equivalent of vld3q. Byte i of a 16-pixel block
+// (48 bytes) belongs to channel i % 3, so each 16-byte load is split into its
+// three channels with byte masks and summed with SAD against zero. Load c
+// starts at byte 16 * c, so mask k (bytes p with p % 3 == k) selects channel
+// (c + k) % 3 of load c.
+__attribute__((target("sse4.1")))
+inline __m128i channelMaskSSE(int k) {
+    alignas(16) uint8_t bytes[16];
+    for (int p = 0; p < 16; p++) {
+        bytes[p] = p % 3 == k ? 0xFF : 0x00;
+    }
+    return _mm_load_si128(reinterpret_cast<const __m128i*>(bytes));
+}
+
+__attribute__((target("sse4.1")))
+inline uint32_t horizontalSumSSE(__m128i v) {
+    // Two 64-bit SAD lanes; span sums fit the low 32 bits of each
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(v)) + static_cast<uint32_t>(_mm_extract_epi32(v, 2));
+}
+
+// One 16-pixel block at p into the per-channel 64-bit SAD accumulators
+__attribute__((target("sse4.1")))
+inline void accumulateBlockSSE(const uint8_t* p, const __m128i mask[3],
+                               __m128i& acc_b, __m128i& acc_g, __m128i& acc_r) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i l0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i l1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+    const __m128i l2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32));
+
+    acc_b = _mm_add_epi64(acc_b, _mm_sad_epu8(_mm_and_si128(l0, mask[0]), zero));
+    acc_g = _mm_add_epi64(acc_g, _mm_sad_epu8(_mm_and_si128(l0, mask[1]), zero));
+    acc_r = _mm_add_epi64(acc_r, _mm_sad_epu8(_mm_and_si128(l0, mask[2]), zero));
+
+    acc_g = _mm_add_epi64(acc_g, _mm_sad_epu8(_mm_and_si128(l1, mask[0]), zero));
+    acc_r = _mm_add_epi64(acc_r, _mm_sad_epu8(_mm_and_si128(l1, mask[1]), zero));
+    acc_b = _mm_add_epi64(acc_b, _mm_sad_epu8(_mm_and_si128(l1, mask[2]), zero));
+
+    acc_r = _mm_add_epi64(acc_r, _mm_sad_epu8(_mm_and_si128(l2, mask[0]), zero));
+    acc_b = _mm_add_epi64(acc_b, _mm_sad_epu8(_mm_and_si128(l2, mask[1]), zero));
+    acc_g = _mm_add_epi64(acc_g, _mm_sad_epu8(_mm_and_si128(l2, mask[2]), zero));
+}
+
+__attribute__((target("sse4.1")))
+inline void accumulateBGRSSE41(const cv::Vec3b* row, int x0, int x1,
+                               uint32_t& sum_b, uint32_t& sum_g, uint32_t& sum_r) {
+    const __m128i mask[3] = {channelMaskSSE(0), channelMaskSSE(1), channelMaskSSE(2)};
+    __m128i acc_b = _mm_setzero_si128();
+    __m128i acc_g = _mm_setzero_si128();
+    __m128i acc_r = _mm_setzero_si128();
+
+    int x = x0;
+    for (; x + 15 < x1; x += 16) {
+        accumulateBlockSSE(reinterpret_cast<const uint8_t*>(row + x), mask, acc_b, acc_g, acc_r);
+    }
+
+    sum_b += horizontalSumSSE(acc_b);
+    sum_g += horizontalSumSSE(acc_g);
+    sum_r += horizontalSumSSE(acc_r);
+
+    accumulateBGRScalar(row, x, x1, sum_b, sum_g, sum_r);
+}
+
+// Same split at 32 pixels (96 bytes) per iteration. 32 % 3 == 2, so mask k
+// selects channel (2 * c + k) % 3 of 32-byte load c.
+__attribute__((target("avx2")))
+inline __m256i channelMaskAVX2(int k) {
+    alignas(32) uint8_t bytes[32];
+    for (int p = 0; p < 32; p++) {
+        bytes[p] = p % 3 == k ? 0xFF : 0x00;
+    }
+    return _mm256_load_si256(reinterpret_cast<const __m256i*>(bytes));
+}
+
+__attribute__((target("avx2")))
+inline uint32_t horizontalSumAVX2(__m256i v) {
+    return horizontalSumSSE(_mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+}
+
+__attribute__((target("avx2")))
+inline void accumulateBGRAVX2(const cv::Vec3b* row, int x0, int x1,
+                              uint32_t& sum_b, uint32_t& sum_g, uint32_t& sum_r) {
+    const __m256i mask[3] = {channelMaskAVX2(0), channelMaskAVX2(1), channelMaskAVX2(2)};
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc_b = _mm256_setzero_si256();
+    __m256i acc_g = _mm256_setzero_si256();
+    __m256i acc_r = _mm256_setzero_si256();
+
+    int x = x0;
+    for (; x + 31 < x1; x += 32) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(row + x);
+        const __m256i l0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i l1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+        const __m256i l2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 64));
+
+        acc_b = _mm256_add_epi64(acc_b, _mm256_sad_epu8(_mm256_and_si256(l0, mask[0]), zero));
+        acc_g = _mm256_add_epi64(acc_g, _mm256_sad_epu8(_mm256_and_si256(l0, mask[1]), zero));
+        acc_r = _mm256_add_epi64(acc_r, _mm256_sad_epu8(_mm256_and_si256(l0, mask[2]), zero));
+
+        acc_r = _mm256_add_epi64(acc_r, _mm256_sad_epu8(_mm256_and_si256(l1, mask[0]), zero));
+        acc_b = _mm256_add_epi64(acc_b, _mm256_sad_epu8(_mm256_and_si256(l1, mask[1]), zero));
+        acc_g = _mm256_add_epi64(acc_g, _mm256_sad_epu8(_mm256_and_si256(l1, mask[2]), zero));
+
+        acc_g = _mm256_add_epi64(acc_g, _mm256_sad_epu8(_mm256_and_si256(l2, mask[0]), zero));
+        acc_r = _mm256_add_epi64(acc_r, _mm256_sad_epu8(_mm256_and_si256(l2, mask[1]), zero));
+        acc_b = _mm256_add_epi64(acc_b, _mm256_sad_epu8(_mm256_and_si256(l2, mask[2]), zero));
+    }
+
+    sum_b += horizontalSumAVX2(acc_b);
+    sum_g += horizontalSumAVX2(acc_g);
+    sum_r += horizontalSumAVX2(acc_r);
+
+    // Narrow LED slices are often 16-31 pixels wide: one 128-bit block before the scalar tail
+    if (x + 15 < x1) {
+        const __m128i mask128[3] = {channelMaskSSE(0), channelMaskSSE(1), channelMaskSSE(2)};
+        __m128i tail_b = _mm_setzero_si128();
+        __m128i tail_g = _mm_setzero_si128();
+        __m128i tail_r = _mm_setzero_si128();
+        accumulateBlockSSE(reinterpret_cast<const uint8_t*>(row + x), mask128, tail_b, tail_g, tail_r);
+        sum_b += horizontalSumSSE(tail_b);
+        sum_g += horizontalSumSSE(tail_g);
+        sum_r += horizontalSumSSE(tail_r);
+        x += 16;
+    }
+
+    accumulateBGRScalar(row, x, x1, sum_b, sum_g, sum_r);
+}
+#endif
+
+// Whether a kernel is compiled in and the CPU can run it
+inline bool isaSupported(Isa isa) {
+    switch (isa) {
+        case Isa::Scalar:
+            return true;
+#ifdef USE_NEON_SIMD
+        case Isa::NEON:
+            return true;
+#endif
+#ifdef USE_X86_SIMD
+        case Isa::SSE41:
+            return __builtin_cpu_supports("sse4.1");
+        case Isa::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+// Fastest kernel this CPU supports (cpuid on x86, compile time on ARM)
+inline Isa bestIsa() {
+    for (Isa isa : {Isa::AVX2, Isa::SSE41, Isa::NEON}) {
+        if (isaSupported(isa)) {
+            return isa;
+        }
+    }
+    return Isa::Scalar;
+}
+
+// Kernel for an ISA, or nullptr if this build/CPU can't run it
+inline AccumulateBGR bgrKernel(Isa isa) {
+    if (!isaSupported(isa)) {
+        return nullptr;
+    }
+    switch (isa) {
+#ifdef USE_NEON_SIMD
+        case Isa::NEON: return accumulateBGRNEON;
+#endif
+#ifdef USE_X86_SIMD
+        case Isa::SSE41: return accumulateBGRSSE41;
+        case Isa::AVX2: return accumulateBGRAVX2;
+#endif
+        default: return accumulateBGRScalar;
+    }
+}
+
+// Planar YUV accumulation for I420 frames over absolute columns [x0, x1)
+// Chroma is sampled at half resolution, so pixel x uses u_row[x / 2] / v_row[x / 2]
+inline void accumulateYUVScalar(const uchar* y_row, const uchar* u_row, const uchar* v_row,
+                                int x0, int x1,
+                                uint32_t& sum_y, uint32_t& sum_u, uint32_t& sum_v) {
+    for (int x = x0; x < x1; x++) {
+        sum_y += y_row[x];
+        sum_u += u_row[x >> 1];
+        sum_v += v_row[x >> 1];
+    }
+}
+
+// ISA accumulateYUV() was built for (NEON or scalar, chosen at compile time)
+inline Isa yuvIsa() {
+#ifdef USE_NEON_SIMD
+    return Isa::NEON;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+// Same sums as accumulateYUVScalar(), vectorized where the build allows
+inline void accumulateYUV(const uchar* y_row, const uchar* u_row, const uchar* v_row,
+                          int x0, int x1,
+                          uint32_t& sum_y, uint32_t& sum_u, uint32_t& sum_v) {
+    int x = x0;
+
+#ifdef USE_NEON_SIMD
+    // Align to an even column so 8 chroma bytes cover exactly 16 luma pixels
+    if ((x & 1) && x < x1) {
+        sum_y += y_row[x];
+        sum_u += u_row[x >> 1];
+        sum_v += v_row[x >> 1];
+        x++;
+    }
+
+    uint32x4_t acc_y = vdupq_n_u32(0);
+    uint32x4_t acc_u = vdupq_n_u32(0);
+    uint32x4_t acc_v = vdupq_n_u32(0);
+
+    for (; x + 15 < x1; x += 16) {
+        acc_y = vpadalq_u16(acc_y, vpaddlq_u8(vld1q_u8(y_row + x)));
+
+        // Each chroma sample stands for two luma columns: count it twice
+        uint16x8_t u_wide = vshlq_n_u16(vmovl_u8(vld1_u8(u_row + (x >> 1))), 1);
+        uint16x8_t v_wide = vshlq_n_u16(vmovl_u8(vld1_u8(v_row + (x >> 1))), 1);
+        acc_u = vpadalq_u16(acc_u, u_wide);
+        acc_v = vpadalq_u16(acc_v, v_wide);
+    }
+
+    sum_y += horizontalSumNEON(acc_y);
+    sum_u += horizontalSumNEON(acc_u);
+    sum_v += horizontalSumNEON(acc_v);
+#endif
+
+    accumulateYUVScalar(y_row, u_row, v_row, x, x1, sum_y, sum_u, sum_v);
+}
+
+} // namespace SpanKernels
+
+} // namespace TVLED
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace TVLED {
+
+/**
+ * Recycles frame buffers between captures.
+ *
+ * acquire() returns a Mat sharing one of the pooled buffers. A buffer becomes
+ * free again once every Mat referring to it is gone (its refcount is back to
+ * the pool's own reference), so frames can be passed downstream without copies
+ * and are never overwritten while somebody still reads them. Once the pipeline
+ * has warmed up no more buffers are allocated; allocations() counts every one
+ * that ever was.
+ *
+ * Not thread-safe: acquire from the producing thread only. Consumers may drop
+ * their Mats on any thread (OpenCV refcounting is atomic).
+ */
+class FramePool {
+public:
+    FramePool() : allocations_(0) {}
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // A buffer of the given size and type that nobody else references.
+    // Fresh buffers are zeroed so partially written frames never show garbage.
+    cv::Mat acquire(cv::Size size, int type) {
+        cv::Mat* spare = nullptr;
+        for (auto& buffer : buffers_) {
+            if (!isFree(buffer)) {
+                continue;
+            }
+            if (buffer.size() == size && buffer.type() == type) {
+                return buffer;
+            }
+            if (!spare) {
+                spare = &buffer;
+            }
+        }
+
+        // Nothing free fits: reshape a free buffer of another size, else grow
+        allocations_++;
+        if (spare) {
+            *spare = cv::Mat::zeros(size, type);
+            return *spare;
+        }
+        buffers_.push_back(cv::Mat::zeros(size, type));
+        return buffers_.back();
+    }
+
+    // Take over a buffer allocated elsewhere (e.g. by a decoder that picked the size)
+    void adopt(const cv::Mat& buffer) {
+        allocations_++;
+        buffers_.push_back(buffer);
+    }
+
+    void clear() { buffers_.clear(); }
+
+    // Buffers allocated since construction; flat in steady state
+    uint64_t allocations() const { return allocations_.load(std::memory_order_relaxed); }
+    size_t size() const { return buffers_.size(); }
+
+private:
+    // Consumers decrement the refcount on other threads, so read it atomically
+    // (acquire pairs with their release, their reads finish before we reuse it)
+    static bool isFree(const cv::Mat& buffer) {
+        return buffer.u && __atomic_load_n(&buffer.u->refcount, __ATOMIC_ACQUIRE) == 1;
+    }
+
+    std::vector<cv::Mat> buffers_;
+    std::atomic<uint64_t> allocations_;
+};
+
+} // namespace TVLED
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace TVLED {
+
+/**
+ * Fixed-bucket latency histogram for per-stage percentiles.
+ *
+ * Samples are counted in buckets of resolution_ms up to max_ms (anything
+ * slower lands in the last bucket), so adding a sample is O(1) and never
+ * allocates. Percentiles are read back with bucket resolution.
+ */
+class LatencyHistogram {
+public:
+    explicit LatencyHistogram(double max_ms = 500.0, double resolution_ms = 0.1)
+        : resolution_ms_(resolution_ms),
+          buckets_(static_cast<size_t>(max_ms / resolution_ms) + 1, 0),
+          count_(0), sum_ms_(0.0), max_ms_(0.0) {}
+
+    void add(double ms) {
+        ms = std::max(ms, 0.0);
+        size_t bucket = std::min(static_cast<size_t>(ms / resolution_ms_), buckets_.size() - 1);
+        buckets_[bucket]++;
+        count_++;
+        sum_ms_ += ms;
+        max_ms_ = std::max(max_ms_, ms);
+    }
+
+    // Latency below which the given fraction (0..1) of samples fall
+    double percentile(double p) const {
+        if (count_ == 0) {
+            return 0.0;
+        }
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * count_ + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets_.size(); i++) {
+            seen += buckets_[i];
+            if (seen >= rank) {
+                return std::min((i + 1) * resolution_ms_, max_ms_);
+            }
+        }
+        return max_ms_;
+    }
+
+    uint64_t count() const { return count_; }
+    double mean() const { return count_ ? sum_ms_ / count_ : 0.0; }
+    double max() const { return max_ms_; }
+
+    void reset() {
+        std::fill(buckets_.begin(), buckets_.end(), 0);
+        count_ = 0;
+        sum_ms_ = 0.0;
+        max_ms_ = 0.0;
+    }
+
+    // "p50 4.1 / p95 6.3 / p99 9.8 / max 12.0 ms"
+    std::string summary() const {
+        char text[96];
+        std::snprintf(text, sizeof(text), "p50 %.1f / p95 %.1f / p99 %.1f / max %.1f ms",
+                      percentile(0.50), percentile(0.95), percentile(0.99), max_ms_);
+        return text;
+    }
+
+private:
+    double resolution_ms_;
+    std::vector<uint32_t> buckets_;
+    uint64_t count_;
+    double sum_ms_;
+    double max_ms_;
+};
+
+} // namespace TVLED
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace TVLED {
+
+/**
+ * Layout of a POSIX shared-memory ring of raw frames, shared between an
+ * external capture process (the writer) and ShmFrameSource (the reader).
+ *
+ * The object starts with a Header, followed by slot_count slots. Each slot
+ * is a SlotHeader and then slot_size bytes of pixels at data_offset:
+ *
+ *   [Header][SlotHeader 0 | pixels 0][SlotHeader 1 | pixels 1] ...
+ *
+ * Publishing frame n (n starts at 1) into slot (n - 1) % slot_count:
+ *   1. slot.sequence = 0            (slot is being written)
+ *   2. write the pixels and slot.timestamp_ns
+ *   3. slot.sequence = n            (release)
+ *   4. published = n, futex = n     (release), then wake futex waiters
+ *
+ * A reader picks slot (published - 1) % slot_count and uses it if its
+ * sequence still equals published. Checking the sequence again later tells
+ * whether the writer has lapped the reader in the meantime.
+ *
+ * All atomics are lock-free and address-free, so they work across processes.
+ */
+namespace ShmFrameRing {
+
+constexpr uint32_t MAGIC = 0x52464C54;  // "TLFR"
+constexpr uint32_t VERSION = 1;
+constexpr size_t ALIGNMENT = 64;
+
+enum Format : uint32_t {
+    FORMAT_BGR = 0,   // CV_8UC3, stride bytes per row (>= width * 3)
+    FORMAT_I420 = 1   // Y plane then U and V at half resolution, tightly packed
+};
+
+struct alignas(ALIGNMENT) SlotHeader {
+    std::atomic<uint64_t> sequence;  // Frame number held, 0 while the writer fills the slot
+    uint64_t timestamp_ns;           // CLOCK_MONOTONIC capture time, 0 = unknown
+};
+
+struct alignas(ALIGNMENT) Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+    uint32_t stride;        // Bytes per row of BGR frames (width for I420)
+    uint32_t slot_count;
+    uint32_t reserved;
+    uint64_t slot_size;     // Bytes from one SlotHeader to the next
+    uint64_t data_offset;   // Pixel offset within a slot
+
+    alignas(ALIGNMENT) std::atomic<uint64_t> published;  // Frames published so far
+    std::atomic<uint32_t> futex;       // Low 32 bits of published, futex word
+    std::atomic<int32_t> writer_pid;   // 0 once the writer has shut down cleanly
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "64-bit atomics must be lock-free in shared memory");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "32-bit atomics must be lock-free in shared memory");
+
+inline size_t alignUp(size_t value) {
+    return (value + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+// Bytes of pixel data in one frame
+inline size_t frameBytes(uint32_t height, uint32_t format, uint32_t stride) {
+    return format == FORMAT_I420 ? static_cast<size_t>(stride) * height * 3 / 2
+                                 : static_cast<size_t>(stride) * height;
+}
+
+// Fill in the geometry fields of a header (everything but the atomics)
+inline void describe(Header& header, uint32_t width, uint32_t height, uint32_t format, uint32_t slot_count) {
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.width = width;
+    header.height = height;
+    header.format = format;
+    header.stride = format == FORMAT_I420 ? width : width * 3;
+    header.slot_count = slot_count;
+    header.reserved = 0;
+    header.data_offset = alignUp(sizeof(SlotHeader));
+    header.slot_size = header.data_offset + alignUp(frameBytes(height, format, header.stride));
+}
+
+// Total size of the shared-memory object described by a header
+inline size_t mappingSize(const Header& header) {
+    return alignUp(sizeof(Header)) + static_cast<size_t>(header.slot_size) * header.slot_count;
+}
+
+inline SlotHeader* slot(void* base, const Header& header, uint64_t frame_number) {
+    const size_t index = static_cast<size_t>((frame_number - 1) % header.slot_count);
+    return reinterpret_cast<SlotHeader*>(static_cast<uint8_t*>(base) + alignUp(sizeof(Header)) +
+                                         index * header.slot_size);
+}
+
+inline uint8_t* slotData(SlotHeader* slot_header, const Header& header) {
+    return reinterpret_cast<uint8_t*>(slot_header) + header.data_offset;
+}
+
+inline uint64_t monotonicNanoseconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// Block until the futex word differs from seen or timeout_ms passes.
+// Spurious returns are fine, callers re-check published.
+inline void waitForFrame(Header& header, uint32_t seen, int timeout_ms) {
+#ifdef __linux__
+    timespec timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000L;
+    // Shared (non-private) futex: the word lives in memory mapped by another process
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&header.futex), FUTEX_WAIT, seen, &timeout, nullptr, 0);
+#else
+    (void)timeout_ms;
+    if (header.futex.load(std::memory_order_acquire) == seen) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+#endif
+}
+
+inline void wakeReaders(Header& header) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&header.futex), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+#else
+    (void)header;
+#endif
+}
+
+// Writer side of steps 1-4 above; fill() writes the pixels into the slot
+template <typename Fill>
+inline void publish(void* base, Header& header, uint64_t timestamp_ns, Fill fill) {
+    const uint64_t n = header.published.load(std::memory_order_relaxed) + 1;
+    SlotHeader* s = slot(base, header, n);
+
+    s->sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    fill(slotData(s, header));
+    s->timestamp_ns = timestamp_ns;
+    s->sequence.store(n, std::memory_order_release);
+
+    header.published.store(n, std::memory_order_release);
+    header.futex.store(static_cast<uint32_t>(n), std::memory_order_release);
+    wakeReaders(header);
+}
+
+} // namespace ShmFrameRing
+
+} // namespace TVLED
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace TVLED {
+
+/**
+ * Persistent fork-join pool for per-frame work.
+ *
+ * The threads are started once and sleep between jobs, so a frame only pays
+ * for a wakeup, not for thread creation. parallelFor(count, task) calls
+ * task(index, worker) for every index in [0, count) and returns when all are
+ * done. The calling thread takes part as worker 0, workers 1..size()-1 are the
+ * pool threads, so per-worker scratch indexed by worker is never shared.
+ *
+ * Indices are dealt out as one contiguous range per worker. A worker takes
+ * from the front of its own range and, once that is empty, steals from the
+ * back of the others'. Front and back of a range are packed into one atomic
+ * word, so owner and thieves agree with a single compare-exchange.
+ *
+ * One job runs at a time: concurrent parallelFor() calls are serialized.
+ * Tasks must not throw.
+ */
+class ThreadPool {
+public:
+    // threads counts the calling thread: threads - 1 pool threads are started.
+    // With pin_threads each pool thread is bound to one core (Linux only).
+    explicit ThreadPool(size_t threads, bool pin_threads = false)
+        : ranges_(std::max<size_t>(threads, 1)), stop_(false), generation_(0), pending_(0),
+          task_context_(nullptr), task_invoke_(nullptr) {
+        const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t worker = 1; worker < ranges_.size(); worker++) {
+            threads_.emplace_back(&ThreadPool::workerLoop, this, worker);
+            if (pin_threads) {
+                pinToCore(threads_.back(), worker % cores);
+            }
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Workers taking part in a job, including the caller
+    size_t size() const { return ranges_.size(); }
+
+    template <typename Task>
+    void parallelFor(size_t count, Task&& task) {
+        using TaskType = typename std::remove_reference<Task>::type;
+        if (count == 0) {
+            return;
+        }
+        if (ranges_.size() == 1 || count == 1) {
+            for (size_t index = 0; index < count; index++) {
+                task(index, 0);
+            }
+            return;
+        }
+        run(count, const_cast<void*>(static_cast<const void*>(&task)), [](void* context, size_t index, size_t worker) {
+            (*static_cast<TaskType*>(context))(index, worker);
+        });
+    }
+
+private:
+    using Invoke = void (*)(void* context, size_t index, size_t worker);
+
+    // Own cache line per range: owners and thieves hammer these words
+    struct alignas(64) Range {
+        std::atomic<uint64_t> bounds{0};  // begin << 32 | end
+    };
+
+    static uint64_t pack(uint64_t begin, uint64_t end) { return begin << 32 | end; }
+
+    void run(size_t count, void* context, Invoke invoke) {
+        std::lock_guard<std::mutex> job(job_mutex_);
+
+        const size_t workers = ranges_.size();
+        for (size_t worker = 0; worker < workers; worker++) {
+            ranges_[worker].bounds.store(pack(count * worker / workers, count * (worker + 1) / workers),
+                                         std::memory_order_relaxed);
+        }
+        task_context_ = context;
+        task_invoke_ = invoke;
+        pending_.store(workers - 1, std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            generation_++;
+        }
+        wake_.notify_all();
+
+        runTasks(0);
+
+        std::unique_lock<std::mutex> lock(done_mutex_);
+        done_.wait(lock, [this] { return pending_.load(std::memory_order_acquire) == 0; });
+    }
+
+    void workerLoop(size_t worker) {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(wake_mutex_);
+                wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) {
+                    return;
+                }
+                seen = generation_;
+            }
+
+            runTasks(worker);
+
+            if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(done_mutex_);
+                done_.notify_one();
+            }
+        }
+    }
+
+    void runTasks(size_t worker) {
+        size_t index;
+        while (takeFront(ranges_[worker], index)) {
+            task_invoke_(task_context_, index, worker);
+        }
+        for (size_t k = 1; k < ranges_.size(); k++) {
+            Range& victim = ranges_[(worker + k) % ranges_.size()];
+            while (takeBack(victim, index)) {
+                task_invoke_(task_context_, index, worker);
+            }
+        }
+    }
+
+    static bool takeFront(Range& range, size_t& index) {
+        uint64_t bounds = range.bounds.load(std::memory_order_relaxed);
+        while (true) {
+            const uint64_t begin = bounds >> 32;
+            const uint64_t end = bounds & 0xFFFFFFFFu;
+            if (begin >= end) {
+                return false;
+            }
+            if (range.bounds.compare_exchange_weak(bounds, pack(begin + 1, end), std::memory_order_relaxed)) {
+                index = static_cast<size_t>(begin);
+                return true;
+            }
+        }
+    }
+
+    static bool takeBack(Range& range, size_t& index) {
+        uint64_t bounds = range.bounds.load(std::memory_order_relaxed);
+        while (true) {
+            const uint64_t begin = bounds >> 32;
+            const uint64_t end = bounds & 0xFFFFFFFFu;
+            if (begin >= end) {
+                return false;
+            }
+            if (range.bounds.compare_exchange_weak(bounds, pack(begin, end - 1), std::memory_order_relaxed)) {
+                index = static_cast<size_t>(end - 1);
+                return true;
+            }
+        }
+    }
+
+    static void pinToCore(std::thread& thread, size_t core) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+        (void)thread;
+        (void)core;
+#endif
+    }
+
+    std::vector<Range> ranges_;
+    std::vector<std::thread> threads_;
+
+    std::mutex job_mutex_;  // One parallelFor() at a time
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool stop_;
+    uint64_t generation_;  // Bumped per job, guarded by wake_mutex_
+
+    std::mutex done_mutex_;
+    std::condition_variable done_;
+    std::atomic<size_t> pending_;  // Pool threads still working on the job
+
+    void* task_context_;
+    Invoke task_invoke_;
+};
+
+} // namespace TVLED
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace TVLED {
+
+/**
+ * Lock-free single-producer / single-consumer triple buffer.
+ *
+ * The producer always owns one slot (back), the consumer owns another (front)
+ * and the third (middle) holds the most recently published value. Publishing
+ * and consuming are a single atomic exchange each, so neither side ever waits
+ * for the other and the consumer always gets the newest value (latest wins).
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : back_(0), front_(1), middle_(2) {}
+
+    // Producer: slot to fill before calling publish()
+    T& writeSlot() { return slots_[back_]; }
+
+    // Producer: make the write slot visible to the consumer.
+    // Returns true if an unread value was overwritten (i.e. dropped).
+    bool publish() {
+        uint8_t prev = middle_.exchange(static_cast<uint8_t>(back_ | kFreshBit),
+                                        std::memory_order_acq_rel);
+        back_ = prev & kIndexMask;
+        return (prev & kFreshBit) != 0;
+    }
+
+    // Consumer: true if a value was published since the last consume()
+    bool hasNew() const {
+        return (middle_.load(std::memory_order_acquire) & kFreshBit) != 0;
+    }
+
+    // Consumer: take ownership of the newest value, returns false if none
+    bool consume() {
+        if (!hasNew()) {
+            return false;
+        }
+        uint8_t prev = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = prev & kIndexMask;
+        return true;
+    }
+
+    // Consumer: value obtained by the last successful consume()
+    T& readSlot() { return slots_[front_]; }
+
+private:
+    static constexpr uint8_t kIndexMask = 0x03;
+    static constexpr uint8_t kFreshBit = 0x04;
+
+    T slots_[3];
+    uint8_t back_;                 // Producer-owned
+    uint8_t front_;                // Consumer-owned
+    std::atomic<uint8_t> middle_;  // Shared: index | fresh flag
+};
+
+} // namespace TVLED
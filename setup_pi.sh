@@ -37,6 +37,10 @@ sudo apt-get install -y rpicam-apps
 echo "Installing OpenCV..."
 sudo apt-get install -y libopencv-dev
 
+# Install libjpeg-turbo (faster scaled and region-of-interest MJPEG decoding)
+echo "Installing libjpeg-turbo..."
+sudo apt-get install -y libturbojpeg0-dev libjpeg-dev
+
 # Install FlatBuffers (for HyperHDR communication)
 echo "Installing FlatBuffers..."
 sudo apt-get install -y flatbuffers-compiler libflatbuffers-dev
@@ -110,7 +110,8 @@ void HyperHDRClient::disconnect() {
     LOG_INFO("Disconnected from HyperHDR");
 }
 
-bool HyperHDRClient::sendColors(const std::vector<cv::Vec3b>& colors, const LEDLayout& layout) {
+bool HyperHDRClient::sendColors(const std::vector<cv::Vec3b>& colors, const LEDLayout& layout,
+                                std::chrono::steady_clock::time_point captured) {
     if (!connected_) {
         LOG_ERROR("Not connected to HyperHDR");
         return false;
@@ -143,10 +144,11 @@ bool HyperHDRClient::sendColors(const std::vector<cv::Vec3b>& colors, const LEDL
     }
     
     // Send message via TCP
-    return sendTCPMessage(message.data(), message.size());
+    return sendFrameMessage(message, captured);
 }
 
-bool HyperHDRClient::sendColorsLinear(const std::vector<cv::Vec3b>& colors) {
+bool HyperHDRClient::sendColorsLinear(const std::vector<cv::Vec3b>& colors,
+                                      std::chrono::steady_clock::time_point captured) {
     if (!connected_) {
         LOG_ERROR("Not connected to HyperHDR");
         return false;
@@ -178,7 +180,18 @@ bool HyperHDRClient::sendColorsLinear(const std::vector<cv::Vec3b>& colors) {
     }
     
     // Send message via TCP
-    return sendTCPMessage(message.data(), message.size());
+    return sendFrameMessage(message, captured);
+}
+
+bool HyperHDRClient::sendFrameMessage(const std::vector<uint8_t>& message,
+                                      std::chrono::steady_clock::time_point captured) {
+    if (!sendTCPMessage(message.data(), message.size())) {
+        return false;
+    }
+    if (captured != std::chrono::steady_clock::time_point{}) {
+        latency_.add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - captured).count());
+    }
+    return true;
 }
 
 bool HyperHDRClient::sendTCPMessage(const uint8_t* data, size_t size) {
@@ -171,7 +171,8 @@ void USBController::disconnect() {
     LOG_INFO("Disconnected from USB device");
 }
 
-bool USBController::sendColors(const std::vector<cv::Vec3b>& colors) {
+bool USBController::sendColors(const std::vector<cv::Vec3b>& colors,
+                               std::chrono::steady_clock::time_point captured) {
     if (!connected_) {
         LOG_ERROR("Not connected to USB device");
         return false;
@@ -210,6 +211,9 @@ bool USBController::sendColors(const std::vector<cv::Vec3b>& colors) {
         LOG_ERROR("Failed to send data to USB device");
         return false;
     }
+    if (captured != std::chrono::steady_clock::time_point{}) {
+        latency_.add(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - captured).count());
+    }
     
     LOG_INFO("Successfully sent " + std::to_string(colors.size()) + 
              " LED colors (" + std::to_string(packet.size()) + " bytes)");
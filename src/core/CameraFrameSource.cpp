@@ -5,28 +5,83 @@
 #include <chrono>
 #include <cstdlib>
 #include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
 
 namespace TVLED {
 
+namespace {
+    // rpicam-vid takes a while to configure the sensor before the first frame
+    constexpr int STARTUP_TIMEOUT_MS = 5000;
+    
+    // Sensor timestamps (--save-pts) are written to this fd in the child
+    constexpr int PTS_CHILD_FD = 3;
+    constexpr size_t MAX_PENDING_PTS = 256;
+}
+
 CameraFrameSource::CameraFrameSource(const std::string& device, int width, int height, int fps, int sensor_mode,
                                      const std::string& autofocus_mode, float lens_position,
                                      const std::string& awb_mode, float awb_gain_red, float awb_gain_blue,
                                      float awb_temperature, float analogue_gain, float digital_gain,
                                      int exposure_time, const std::vector<float>& color_correction_matrix,
                                      bool enable_scaling, int scaled_width, int scaled_height,
-                                     bool flip_horizontal, bool flip_vertical)
+                                     bool flip_horizontal, bool flip_vertical,
+                                     const std::string& codec, int yuv_stride,
+                                     bool dct_scaling, bool fast_decode,
+                                     bool native_output)
     : device_(device), width_(width), height_(height), fps_(fps), sensor_mode_(sensor_mode),
       autofocus_mode_(autofocus_mode), lens_position_(lens_position),
       awb_mode_(awb_mode), awb_gain_red_(awb_gain_red), awb_gain_blue_(awb_gain_blue),
       awb_temperature_(awb_temperature), analogue_gain_(analogue_gain), digital_gain_(digital_gain),
       exposure_time_(exposure_time), color_correction_matrix_(color_correction_matrix),
-      initialized_(false), camera_pipe_(nullptr),
+      initialized_(false),
       enable_scaling_(enable_scaling), scaled_width_(scaled_width), scaled_height_(scaled_height),
-      flip_horizontal_(flip_horizontal), flip_vertical_(flip_vertical) {
+      flip_horizontal_(flip_horizontal), flip_vertical_(flip_vertical),
+      codec_(codec), yuv_stride_(yuv_stride),
+      dct_scaling_(dct_scaling), fast_decode_(fast_decode), native_output_(native_output),
+      roi_pending_(false), interrupted_(false),
+      camera_fd_(-1), camera_pid_(-1), waiting_for_first_frame_(false),
+      stall_timeout_ms_(1000), max_restarts_(5), restart_delay_ms_(200),
+      pipe_buffer_size_(1 << 20), consecutive_restarts_(0), total_restarts_(0),
+      frames_captured_(0), drain_to_newest_(false), frames_skipped_(0),
+      sensor_timestamps_(true), pts_fd_(-1), stream_frames_(0), pts_first_index_(0),
+      pts_anchored_(false),
+      // MJPEG typically compresses to 5-15% of raw size, reserve conservative estimate
+      splitter_(static_cast<size_t>(width) * height) {
 }
 
 CameraFrameSource::~CameraFrameSource() {
     release();
+    stopCamera();  // In case initialize() failed half-way
+}
+
+void CameraFrameSource::setRecordPath(const std::string& path) {
+    record_path_ = path;
+}
+
+void CameraFrameSource::setSensorTimestamps(bool enable) {
+    sensor_timestamps_ = enable;
+}
+
+void CameraFrameSource::setDrainToNewest(bool enable) {
+    drain_to_newest_ = enable;
+}
+
+void CameraFrameSource::setRecoveryOptions(int stall_timeout_ms, int max_restarts,
+                                           int restart_delay_ms, int pipe_buffer_size) {
+    stall_timeout_ms_ = stall_timeout_ms;
+    max_restarts_ = max_restarts;
+    restart_delay_ms_ = restart_delay_ms;
+    pipe_buffer_size_ = pipe_buffer_size;
 }
 
 int CameraFrameSource::parseCameraIndex() const {
@@ -45,222 +100,715 @@ int CameraFrameSource::parseCameraIndex() const {
     return 0;
 }
 
-bool CameraFrameSource::initialize() {
-    LOG_INFO("Initializing camera (simple pipe method): " + device_ + 
-             " at " + std::to_string(width_) + "x" + std::to_string(height_) + 
-             "@" + std::to_string(fps_) + "fps");
+std::vector<std::string> CameraFrameSource::buildCommand() const {
+    int camera_index = parseCameraIndex();
     
-    try {
-        int camera_index = parseCameraIndex();
-        
-        // Build rpicam-vid command with MJPEG stream output
-        std::string cmd = "rpicam-vid";
-        cmd += " --camera " + std::to_string(camera_index);
-        cmd += " --width " + std::to_string(width_);
-        cmd += " --height " + std::to_string(height_);
-        cmd += " --framerate " + std::to_string(fps_);
-        cmd += " --timeout 0";  // Run indefinitely
-        cmd += " --nopreview";  // No preview window
-        cmd += " --codec mjpeg";  // MJPEG stream
-        
-        // Add autofocus settings
-        if (!autofocus_mode_.empty() && autofocus_mode_ != "default") {
-            cmd += " --autofocus-mode " + autofocus_mode_;
-            if (autofocus_mode_ == "manual" && lens_position_ > 0.0f) {
-                cmd += " --lens-position " + std::to_string(lens_position_);
+    // rpicam-vid arguments, passed as argv (no shell involved)
+    std::vector<std::string> args = {"rpicam-vid"};
+    auto add = [&args](const std::string& flag, const std::string& value) {
+        args.push_back(flag);
+        args.push_back(value);
+    };
+    
+    add("--camera", std::to_string(camera_index));
+    add("--width", std::to_string(outputWidth()));
+    add("--height", std::to_string(outputHeight()));
+    add("--framerate", std::to_string(fps_));
+    add("--timeout", "0");  // Run indefinitely
+    args.push_back("--nopreview");  // No preview window
+    if (codec_ == "yuv420") {
+        // Raw I420 frames: the ISP scales and flips for free, nothing to decode
+        add("--codec", "yuv420");
+        if (flip_horizontal_) args.push_back("--hflip");
+        if (flip_vertical_) args.push_back("--vflip");
+    } else {
+        add("--codec", "mjpeg");  // MJPEG stream
+    }
+    
+    // Add autofocus settings
+    if (!autofocus_mode_.empty() && autofocus_mode_ != "default") {
+        add("--autofocus-mode", autofocus_mode_);
+        if (autofocus_mode_ == "manual" && lens_position_ > 0.0f) {
+            add("--lens-position", std::to_string(lens_position_));
+        }
+    }
+    
+    // Add white balance settings
+    if (!awb_mode_.empty() && awb_mode_ != "auto") {
+        add("--awb", awb_mode_);
+        // If custom mode and gains are specified, add them
+        if (awb_mode_ == "custom" && awb_gain_red_ > 0.0f && awb_gain_blue_ > 0.0f) {
+            add("--awbgains", std::to_string(awb_gain_red_) + "," + std::to_string(awb_gain_blue_));
+        }
+    }
+    
+    // Note: awb-temperature is not supported by rpicam-vid
+    // Color temperature is implicitly set by AWB mode or custom gains
+    
+    // Add gain settings
+    if (analogue_gain_ > 0.0f) {
+        add("--gain", std::to_string(analogue_gain_));
+    }
+    
+    // Note: digital-gain may not be supported on all rpicam-vid versions
+    // Keeping the parameter but it may be ignored
+    if (digital_gain_ > 0.0f) {
+        LOG_WARN("digital-gain parameter may not be supported by rpicam-vid");
+        // add("--digital-gain", std::to_string(digital_gain_));
+    }
+    
+    // Add exposure time (shutter speed in microseconds)
+    // Note: rpicam-vid uses --shutter for exposure time, not --exposure
+    // --exposure is for exposure mode (normal, sport, etc.)
+    if (exposure_time_ > 0) {
+        add("--shutter", std::to_string(exposure_time_));
+    }
+    
+    // Add color correction matrix if specified (9 values for 3x3 matrix)
+    // NOTE: CCM requires explicit AWB gains to be set (awb_mode must be "custom")
+    if (color_correction_matrix_.size() == 9) {
+        if (awb_mode_ == "custom" && awb_gain_red_ > 0.0f && awb_gain_blue_ > 0.0f) {
+            // rpicam-vid expects CCM in format: m00,m01,m02,m10,m11,m12,m20,m21,m22
+            std::string ccm_str;
+            for (size_t i = 0; i < color_correction_matrix_.size(); ++i) {
+                if (i > 0) ccm_str += ",";
+                ccm_str += std::to_string(color_correction_matrix_[i]);
             }
+            add("--ccm", ccm_str);
+        } else {
+            LOG_WARN("Color correction matrix requires awb_mode='custom' with explicit AWB gains");
         }
-        
-        // Add white balance settings
-        if (!awb_mode_.empty() && awb_mode_ != "auto") {
-            cmd += " --awb " + awb_mode_;
-            // If custom mode and gains are specified, add them
-            if (awb_mode_ == "custom" && awb_gain_red_ > 0.0f && awb_gain_blue_ > 0.0f) {
-                cmd += " --awbgains " + std::to_string(awb_gain_red_) + "," + std::to_string(awb_gain_blue_);
+    }
+    
+    // Write each frame out as soon as it is encoded; otherwise stdio keeps the
+    // tail of every JPEG buffered until the next frame arrives
+    args.push_back("--flush");
+    
+    add("--output", "-");  // Output to stdout
+    return args;
+}
+
+int CameraFrameSource::openStream() {
+    std::vector<std::string> args = buildCommand();
+    
+    // Sensor timestamps come back on a second pipe, mapped to fd 3 in the child
+    int pts_fds[2] = {-1, -1};
+    if (sensor_timestamps_) {
+        if (pipe2(pts_fds, O_CLOEXEC) == 0) {
+            args.push_back("--save-pts");
+            args.push_back("/dev/fd/" + std::to_string(PTS_CHILD_FD));
+        } else {
+            LOG_WARN("Failed to create timestamp pipe, using arrival times: " + std::string(strerror(errno)));
+        }
+    }
+    
+    std::string cmd;
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+        cmd += (cmd.empty() ? "" : " ") + arg;
+        argv.push_back(&arg[0]);
+    }
+    argv.push_back(nullptr);
+    LOG_DEBUG("Camera command: " + cmd);
+    
+    int pipe_fds[2];
+    if (pipe2(pipe_fds, O_CLOEXEC) != 0) {
+        LOG_ERROR("Failed to create camera pipe: " + std::string(strerror(errno)));
+        return -1;
+    }
+    
+#ifdef F_SETPIPE_SZ
+    // A larger pipe lets the camera write whole frames without waiting on us
+    if (pipe_buffer_size_ > 0) {
+        if (fcntl(pipe_fds[0], F_SETPIPE_SZ, pipe_buffer_size_) < 0) {
+            LOG_WARN("Failed to enlarge camera pipe to " + std::to_string(pipe_buffer_size_) +
+                     " bytes: " + std::string(strerror(errno)));
+        }
+        LOG_DEBUG("Camera pipe buffer: " + std::to_string(fcntl(pipe_fds[0], F_GETPIPE_SZ)) + " bytes");
+    }
+#endif
+    
+    // Child: stdout -> pipe, stderr -> /dev/null (suppress rpicam-vid logging)
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    if (pts_fds[1] >= 0) {
+        posix_spawn_file_actions_adddup2(&actions, pts_fds[1], PTS_CHILD_FD);
+    }
+    
+    pid_t pid = -1;
+    int rc = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(pipe_fds[1]);
+    if (pts_fds[1] >= 0) {
+        close(pts_fds[1]);
+    }
+    
+    if (rc != 0) {
+        close(pipe_fds[0]);
+        if (pts_fds[0] >= 0) {
+            close(pts_fds[0]);
+        }
+        LOG_ERROR("Failed to start camera process: " + std::string(strerror(rc)));
+        LOG_ERROR("Make sure rpicam-vid is installed: sudo apt install rpicam-apps");
+        return -1;
+    }
+    
+    camera_pid_ = pid;
+    if (pts_fds[0] >= 0) {
+        pts_fd_ = pts_fds[0];
+        fcntl(pts_fd_, F_SETFL, fcntl(pts_fd_, F_GETFL) | O_NONBLOCK);
+    }
+    LOG_INFO("Camera process started (pid " + std::to_string(pid) + ")");
+    return pipe_fds[0];
+}
+
+bool CameraFrameSource::onEndOfStream(int fd) {
+    (void)fd;
+    LOG_ERROR("Camera pipe reached EOF (camera process exited)");
+    return false;
+}
+
+bool CameraFrameSource::startCamera() {
+    int fd = openStream();
+    if (fd < 0) {
+        return false;
+    }
+    
+    // Non-blocking reads, waiting happens in poll() with a deadline
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    
+    camera_fd_ = fd;
+    waiting_for_first_frame_ = true;
+    
+    // Frame numbers and PTS start over with the new stream
+    stream_frames_ = 0;
+    pts_ms_.clear();
+    pts_first_index_ = 0;
+    pts_text_.clear();
+    pts_anchored_ = false;
+    
+    // Stream buffer was pre-allocated in the constructor, just drop stale data
+    splitter_.reset();
+    return true;
+}
+
+void CameraFrameSource::stopCamera() {
+    if (camera_fd_ >= 0) {
+        close(camera_fd_);
+        camera_fd_ = -1;
+    }
+    if (pts_fd_ >= 0) {
+        close(pts_fd_);
+        pts_fd_ = -1;
+    }
+    
+    if (camera_pid_ > 0) {
+        // Closing the pipe usually ends it (SIGPIPE); ask politely, then insist
+        kill(camera_pid_, SIGTERM);
+        int status = 0;
+        pid_t result = 0;
+        for (int i = 0; i < 50 && result == 0; i++) {
+            result = waitpid(camera_pid_, &status, WNOHANG);
+            if (result == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
             }
         }
-        
-        // Note: awb-temperature is not supported by rpicam-vid
-        // Color temperature is implicitly set by AWB mode or custom gains
-        
-        // Add gain settings
-        if (analogue_gain_ > 0.0f) {
-            cmd += " --gain " + std::to_string(analogue_gain_);
+        if (result == 0) {
+            LOG_WARN("Camera process did not exit, killing it");
+            kill(camera_pid_, SIGKILL);
+            waitpid(camera_pid_, &status, 0);
         }
-        
-        // Note: digital-gain may not be supported on all rpicam-vid versions
-        // Keeping the parameter but it may be ignored
-        if (digital_gain_ > 0.0f) {
-            LOG_WARN("digital-gain parameter may not be supported by rpicam-vid");
-            // cmd += " --digital-gain " + std::to_string(digital_gain_);
+        camera_pid_ = -1;
+    }
+}
+
+void CameraFrameSource::drainTimestamps() {
+    char chunk[1024];
+    ssize_t n;
+    while ((n = read(pts_fd_, chunk, sizeof(chunk))) > 0) {
+        pts_text_.append(chunk, static_cast<size_t>(n));
+    }
+    
+    // One "<ms>.<us>" line per frame after a "# timecode format v2" header
+    size_t start = 0;
+    size_t end;
+    while ((end = pts_text_.find('\n', start)) != std::string::npos) {
+        if (pts_text_[start] != '#' && end > start) {
+            pts_ms_.push_back(std::strtod(pts_text_.c_str() + start, nullptr));
         }
-        
-        // Add exposure time (shutter speed in microseconds)
-        // Note: rpicam-vid uses --shutter for exposure time, not --exposure
-        // --exposure is for exposure mode (normal, sport, etc.)
-        if (exposure_time_ > 0) {
-            cmd += " --shutter " + std::to_string(exposure_time_);
+        start = end + 1;
+    }
+    pts_text_.erase(0, start);
+    
+    // Never grow without bound if frames stop being matched
+    while (pts_ms_.size() > MAX_PENDING_PTS) {
+        pts_ms_.pop_front();
+        pts_first_index_++;
+    }
+}
+
+bool CameraFrameSource::sensorTimestamp(uint64_t sequence, double& pts_ms) {
+    // Never waits: a PTS line that has not arrived yet leaves the arrival time
+    drainTimestamps();
+    if (sequence < pts_first_index_ || sequence - pts_first_index_ >= pts_ms_.size()) {
+        return false;  // Already dropped, or not written yet
+    }
+    while (pts_first_index_ < sequence) {
+        pts_ms_.pop_front();
+        pts_first_index_++;
+    }
+    pts_ms = pts_ms_.front();
+    pts_ms_.pop_front();
+    pts_first_index_++;
+    return true;
+}
+
+void CameraFrameSource::stampFrame() {
+    FrameTiming& timing = frame_timing_;
+    timing.received = FrameTiming::Clock::now();
+    timing.captured = timing.received;
+    timing.sequence = stream_frames_++;
+    timing.sensor_timestamp = false;
+}
+
+void CameraFrameSource::attachSensorTimestamp(FrameTiming& timing) {
+    // Only the frame handed out is looked up, after its decode, by which time
+    // rpicam-vid has written its PTS line; skipped frames' lines are dropped
+    double pts_ms = 0.0;
+    if (pts_fd_ < 0 || !sensorTimestamp(timing.sequence, pts_ms)) {
+        return;
+    }
+    
+    // --save-pts only gives times since the stream's first frame, not the
+    // sensor clock, so the offset to steady_clock is unknown. Anchor them so
+    // that the quickest frame so far arrived the instant it was captured:
+    // captured is then exact relative to other frames, and the pipe stage is
+    // the jitter on top of that quickest frame, not its absolute latency.
+    auto pts = std::chrono::duration_cast<FrameTiming::Clock::duration>(
+        std::chrono::duration<double, std::milli>(pts_ms));
+    auto origin = timing.received - pts;
+    if (!pts_anchored_ || origin < pts_origin_) {
+        pts_origin_ = origin;
+        pts_anchored_ = true;
+    }
+    timing.captured = pts_origin_ + pts;
+    timing.sensor_timestamp = true;
+}
+
+bool CameraFrameSource::restartCamera() {
+    if (consecutive_restarts_ >= max_restarts_) {
+        LOG_ERROR("Camera failed " + std::to_string(consecutive_restarts_) +
+                  " restarts in a row, giving up");
+        return false;
+    }
+    
+    // Back off exponentially while the camera keeps failing right after restarts
+    int delay_ms = std::min(restart_delay_ms_ << std::min(consecutive_restarts_, 4), 5000);
+    consecutive_restarts_++;
+    total_restarts_++;
+    LOG_WARN("Restarting camera in " + std::to_string(delay_ms) + " ms (attempt " +
+             std::to_string(consecutive_restarts_) + "/" + std::to_string(max_restarts_) + ")");
+    
+    stopCamera();
+    const auto restart_at = std::chrono::steady_clock::now() + std::chrono::milliseconds(delay_ms);
+    while (std::chrono::steady_clock::now() < restart_at) {
+        if (interrupted_) {
+            return false;
         }
-        
-        // Add color correction matrix if specified (9 values for 3x3 matrix)
-        // NOTE: CCM requires explicit AWB gains to be set (awb_mode must be "custom")
-        if (color_correction_matrix_.size() == 9) {
-            if (awb_mode_ == "custom" && awb_gain_red_ > 0.0f && awb_gain_blue_ > 0.0f) {
-                // rpicam-vid expects CCM in format: m00,m01,m02,m10,m11,m12,m20,m21,m22
-                std::string ccm_str;
-                for (size_t i = 0; i < color_correction_matrix_.size(); ++i) {
-                    if (i > 0) ccm_str += ",";
-                    ccm_str += std::to_string(color_correction_matrix_[i]);
-                }
-                cmd += " --ccm " + ccm_str;
-            } else {
-                LOG_WARN("Color correction matrix requires awb_mode='custom' with explicit AWB gains");
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+            INTERRUPT_SLICE, restart_at - std::chrono::steady_clock::now()));
+    }
+    if (interrupted_) {
+        return false;
+    }
+    
+    // A failed spawn counts as a failed attempt, getFrame() will come back here
+    startCamera();
+    return true;
+}
+
+bool CameraFrameSource::readSome(uint8_t* data, size_t size, size_t& bytes_read) {
+    // rpicam-vid needs a moment to configure the sensor before the first frame
+    const int timeout_ms = waiting_for_first_frame_ ? std::max(stall_timeout_ms_, STARTUP_TIMEOUT_MS)
+                                                    : stall_timeout_ms_;
+    
+    while (true) {
+        ssize_t n = read(camera_fd_, data, size);
+        if (n > 0) {
+            bytes_read = static_cast<size_t>(n);
+            waiting_for_first_frame_ = false;
+            return true;
+        }
+        if (n == 0) {
+            if (onEndOfStream(camera_fd_)) {
+                continue;
             }
+            return false;
         }
-        
-        cmd += " --output -";  // Output to stdout
-        cmd += " 2>/dev/null";  // Suppress stderr
-        
-        LOG_DEBUG("Camera command: " + cmd);
-        
-        // Open pipe to camera
-        camera_pipe_ = popen(cmd.c_str(), "r");
-        
-        if (!camera_pipe_) {
-            LOG_ERROR("Failed to start camera pipe");
-            LOG_ERROR("Make sure rpicam-vid is installed: sudo apt install rpicam-apps");
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            LOG_ERROR("Camera pipe read error: " + std::string(strerror(errno)));
             return false;
         }
         
-        LOG_INFO("Camera pipe started successfully");
-        
-        // Pre-allocate frame buffer for MJPEG (compressed)
-        // MJPEG typically compresses to 5-15% of raw size, reserve conservative estimate
-        size_t buffer_size = width_ * height_;  // Reserve for worst-case
-        frame_buffer_.reserve(buffer_size);
-        
-        LOG_INFO("Frame buffer capacity reserved: " + std::to_string(buffer_size) + " bytes");
+        // Wait in slices so interrupt() is seen while the camera is silent
+        int waited_ms = 0;
+        int ready = 0;
+        while (ready == 0 && waited_ms < timeout_ms) {
+            if (interrupted_) {
+                return false;
+            }
+            const int slice_ms = std::min(static_cast<int>(INTERRUPT_SLICE.count()), timeout_ms - waited_ms);
+            pollfd pfd{camera_fd_, POLLIN, 0};
+            ready = poll(&pfd, 1, slice_ms);
+            if (ready < 0 && errno != EINTR) {
+                LOG_ERROR("Camera pipe poll error: " + std::string(strerror(errno)));
+                return false;
+            }
+            waited_ms += slice_ms;
+        }
+        if (ready == 0) {
+            LOG_ERROR("Camera stalled: no data for " + std::to_string(timeout_ms) + " ms");
+            return false;
+        }
+    }
+}
+
+bool CameraFrameSource::initialize() {
+    LOG_INFO("Initializing " + getName());
+    interrupted_ = false;
+    
+    try {
+        configureStream();
         
-        // Wait for camera to warm up
-        LOG_DEBUG("Warming up camera (2 seconds)...");
-        std::this_thread::sleep_for(std::chrono::milliseconds(2000));
+        if (!startCamera()) {
+            return false;
+        }
         
-        // Discard warmup frames
-        LOG_DEBUG("Discarding warmup frames...");
-        for (int i = 0; i < 3; i++) {
-            cv::Mat dummy;
-            getFrameInternal(dummy);  // Read and discard
+        // Let auto exposure/white balance settle, draining frames so the pipe
+        // never holds stale ones when processing starts
+        if (needsWarmup()) {
+            LOG_DEBUG("Warming up camera (2 seconds)...");
+            auto warmup_end = std::chrono::steady_clock::now() + std::chrono::milliseconds(2000);
+            int warmup_frames = 0;
+            while (std::chrono::steady_clock::now() < warmup_end || warmup_frames < 3) {
+                cv::Mat dummy;
+                FrameTiming timing;
+                if (!readFrame(dummy, timing)) {
+                    LOG_ERROR("Camera failed during warmup");
+                    stopCamera();
+                    return false;
+                }
+                warmup_frames++;
+            }
+            
+            LOG_INFO("Camera warmup complete and ready (" + std::to_string(warmup_frames) + " frames discarded)");
         }
         
-        LOG_INFO("Camera warmup complete and ready");
+        // Record only settled frames
+        if (!record_path_.empty()) {
+            if (codec_ != "mjpeg") {
+                LOG_WARN("Recording needs the mjpeg codec, not recording");
+            } else if (!recorder_.open(record_path_)) {
+                stopCamera();
+                return false;
+            }
+        }
         
         initialized_ = true;
         return true;
         
     } catch (const std::exception& e) {
         LOG_ERROR("Exception during camera initialization: " + std::string(e.what()));
-        release();
+        stopCamera();
         return false;
     }
 }
 
+void CameraFrameSource::configureStream() {
+    if (codec_ == "yuv420") {
+        int stride = yuv_stride_ > 0 ? yuv_stride_ : ((outputWidth() + 63) & ~63);
+        yuv_stride_ = stride;
+        if (stride != outputWidth()) {
+            yuv_buffer_.resize(static_cast<size_t>(stride) * outputHeight() * 3 / 2);
+            LOG_INFO("YUV420 stream stride " + std::to_string(stride) + " (rows repacked to " +
+                     std::to_string(outputWidth()) + ")");
+        }
+    } else {
+        LOG_INFO("Stream buffer capacity reserved: " + std::to_string(splitter_.capacity()) + " bytes");
+        
+        if (enable_scaling_ && dct_scaling_) {
+            decoder_.setTargetSize(scaled_width_, scaled_height_);
+        } else {
+            decoder_.setTargetSize(0, 0);
+        }
+        decoder_.setFastDecode(fast_decode_);
+        LOG_INFO(std::string("JPEG decoder: ") + (decoder_.usesTurboJPEG() ? "TurboJPEG" : "OpenCV") +
+                 (dct_scaling_ && enable_scaling_ ? ", DCT scaling" : "") +
+                 (fast_decode_ && decoder_.usesTurboJPEG() ? ", fast DCT/upsampling" : ""));
+    }
+}
+
 bool CameraFrameSource::getFrameInternal(cv::Mat& frame) {
-    // Reuse the frame_buffer_ to avoid repeated allocations
-    const size_t chunk_size = 8192;
-    frame_buffer_.clear();  // Clear but keep capacity
-    
-    uint8_t buffer[chunk_size];
-    uint8_t prev_byte = 0;
-    bool found_start = false;
+    // Read straight into the splitter's buffer; read() returns whatever the pipe
+    // holds instead of waiting for a full chunk like fread() does
+    const size_t chunk_size = 65536;
     int read_attempts = 0;
     const int max_read_attempts = 1000;  // Prevent infinite loops
     
-    while (read_attempts++ < max_read_attempts) {
-        size_t bytes_read = fread(buffer, 1, chunk_size, camera_pipe_);
-        if (bytes_read == 0) {
-            // Check for errors vs EOF
-            if (feof(camera_pipe_)) {
-                LOG_ERROR("Camera pipe reached EOF");
-            } else if (ferror(camera_pipe_)) {
-                LOG_ERROR("Camera pipe read error");
-            }
-            return false;
+    const uint8_t* jpeg_data = nullptr;
+    size_t jpeg_size = 0;
+    
+    while (true) {
+        if (drain_to_newest_) {
+            drainPipe(chunk_size);
         }
         
-        for (size_t i = 0; i < bytes_read; i++) {
-            uint8_t byte = buffer[i];
+        // With drain to newest, walk past every complete frame and decode only
+        // the last one (spans stay valid until the next writeBuffer())
+        const uint8_t* newest_data = nullptr;
+        size_t newest_size = 0;
+        while (splitter_.nextFrame(jpeg_data, jpeg_size)) {
+            stampFrame();
+            if (recorder_.isOpen()) {
+                recorder_.write(jpeg_data, jpeg_size, frame_timing_.received);
+            }
             
-            if (!found_start) {
-                // Look for JPEG start marker (0xFF 0xD8)
-                if (prev_byte == 0xFF && byte == 0xD8) {
-                    found_start = true;
-                    frame_buffer_.clear();
-                    frame_buffer_.push_back(0xFF);
-                    frame_buffer_.push_back(0xD8);
-                }
-            } else {
-                // Collecting JPEG data
-                frame_buffer_.push_back(byte);
-                
-                // Look for JPEG end marker (0xFF 0xD9)
-                if (prev_byte == 0xFF && byte == 0xD9) {
-                    // Complete JPEG frame found, decode it
-                    cv::Mat img = cv::imdecode(frame_buffer_, cv::IMREAD_COLOR);
-                    if (!img.empty()) {
-                        frame = img;
-                        return true;
-                    } else {
-                        // Failed to decode, reset and look for next frame
-                        LOG_WARN("Failed to decode JPEG frame, size: " + std::to_string(frame_buffer_.size()));
-                        found_start = false;
-                        frame_buffer_.clear();
-                    }
+            if (drain_to_newest_) {
+                if (newest_data) {
+                    frames_skipped_++;
                 }
+                newest_data = jpeg_data;
+                newest_size = jpeg_size;
+                continue;
             }
             
-            prev_byte = byte;
+            // Decode the span in place, already reduced towards the scaled size
+            if (decoder_.decode(jpeg_data, jpeg_size, frame)) {
+                return true;
+            }
+            // Failed to decode, look for next frame
+            LOG_WARN("Failed to decode JPEG frame, size: " + std::to_string(jpeg_size));
+        }
+        
+        if (newest_data) {
+            if (decoder_.decode(newest_data, newest_size, frame)) {
+                return true;
+            }
+            LOG_WARN("Failed to decode JPEG frame, size: " + std::to_string(newest_size));
+        }
+        
+        if (read_attempts++ >= max_read_attempts) {
+            break;
+        }
+        
+        size_t bytes_read = 0;
+        if (!readSome(splitter_.writeBuffer(chunk_size), chunk_size, bytes_read)) {
+            return false;
         }
+        splitter_.commit(bytes_read);
     }
     
     LOG_ERROR("Exceeded max read attempts without finding complete frame");
     return false;
 }
 
-bool CameraFrameSource::getFrame(cv::Mat& frame) {
-    if (!initialized_ || !camera_pipe_) {
+void CameraFrameSource::drainPipe(size_t chunk_size) {
+    // Pull in everything the camera has written so far without waiting.
+    // EOF and errors are left for readSome() to report.
+    ssize_t n;
+    while ((n = read(camera_fd_, splitter_.writeBuffer(chunk_size), chunk_size)) > 0) {
+        splitter_.commit(static_cast<size_t>(n));
+        waiting_for_first_frame_ = false;
+    }
+}
+
+bool CameraFrameSource::readExact(uint8_t* data, size_t size) {
+    size_t done = 0;
+    
+    while (done < size) {
+        size_t bytes_read = 0;
+        if (!readSome(data + done, size - done, bytes_read)) {
+            return false;
+        }
+        done += bytes_read;
+    }
+    return true;
+}
+
+bool CameraFrameSource::getFrameYUV420(cv::Mat& frame) {
+    const int width = outputWidth();
+    const int height = outputHeight();
+    
+    // Single-channel I420 layout as used by OpenCV: Y plane, then U, then V
+    frame = frame_pool_.acquire(cv::Size(width, height * 3 / 2), CV_8UC1);
+    
+    if (drain_to_newest_) {
+        // Frames have a fixed size: skip whole frames while a newer one is already complete
+        const size_t stream_frame = yuv_buffer_.empty() ? frame.total() : yuv_buffer_.size();
+        uint8_t* scratch = yuv_buffer_.empty() ? frame.data : yuv_buffer_.data();
+        int available = 0;
+        while (ioctl(camera_fd_, FIONREAD, &available) == 0 &&
+               static_cast<size_t>(available) >= 2 * stream_frame) {
+            if (!readExact(scratch, stream_frame)) {
+                return false;
+            }
+            stampFrame();
+            frames_skipped_++;
+        }
+    }
+    
+    if (yuv_buffer_.empty()) {
+        // Tightly packed stream, read straight into the frame
+        if (!readExact(frame.data, static_cast<size_t>(width) * height * 3 / 2)) {
+            return false;
+        }
+        stampFrame();
+        return true;
+    }
+    
+    if (!readExact(yuv_buffer_.data(), yuv_buffer_.size())) {
+        return false;
+    }
+    stampFrame();
+    
+    // Drop the row padding: luma rows first, then both chroma planes
+    const size_t stride = static_cast<size_t>(yuv_stride_);
+    const uint8_t* src = yuv_buffer_.data();
+    uint8_t* dst = frame.data;
+    for (int y = 0; y < height; y++) {
+        std::memcpy(dst, src, width);
+        src += stride;
+        dst += width;
+    }
+    for (int y = 0; y < height; y++) {  // U then V: height/2 rows each
+        std::memcpy(dst, src, width / 2);
+        src += stride / 2;
+        dst += width / 2;
+    }
+    return true;
+}
+
+int CameraFrameSource::outputWidth() const {
+    // In yuv420 mode the ISP scales, so ask the camera for the final size
+    return (codec_ == "yuv420" && enable_scaling_) ? scaled_width_ : width_;
+}
+
+int CameraFrameSource::outputHeight() const {
+    return (codec_ == "yuv420" && enable_scaling_) ? scaled_height_ : height_;
+}
+
+bool CameraFrameSource::getFrame(cv::Mat& frame, FrameTiming& timing) {
+    if (!initialized_) {
         LOG_ERROR("CameraFrameSource not initialized");
         return false;
     }
     
+    // A dead or stalled camera is restarted instead of failing the caller
+    while (!interrupted_) {
+        if (camera_fd_ >= 0 && readFrame(frame, timing)) {
+            frames_captured_++;
+            consecutive_restarts_ = 0;
+            return true;
+        }
+        if (interrupted_ || !restartCamera()) {
+            break;
+        }
+    }
+    if (interrupted_) {
+        LOG_INFO("Camera read interrupted");
+    }
+    return false;
+}
+
+void CameraFrameSource::interrupt() {
+    interrupted_ = true;
+}
+
+bool CameraFrameSource::decodeFrame(cv::Mat& bgr) {
+    // Decoded size is only known after the first frame, until then the decoder allocates
+    const cv::Size decoded = decoder_.outputSize();
+    if (!decoded.empty()) {
+        bgr = frame_pool_.acquire(decoded, CV_8UC3);
+    }
+    
+    const uchar* pooled = bgr.data;
+    if (!getFrameInternal(bgr)) {
+        return false;
+    }
+    if (bgr.data != pooled) {
+        frame_pool_.adopt(bgr);
+    }
+    return true;
+}
+
+bool CameraFrameSource::readFrame(cv::Mat& frame, FrameTiming& timing) {
+    // Return the caller's previous buffer to the pool before picking new ones
+    frame.release();
+    
     try {
+        if (codec_ == "yuv420") {
+            // Already at the final size and orientation
+            if (!getFrameYUV420(frame)) {
+                if (!interrupted_) {
+                    LOG_ERROR("Failed to read frame from stream");
+                }
+                return false;
+            }
+            timing = frame_timing_;
+            timing.decoded = timing.received;
+            attachSensorTimestamp(timing);
+            return true;
+        }
+        
+        if (roi_pending_.exchange(false)) {
+            std::lock_guard<std::mutex> lock(roi_mutex_);
+            decoder_.setRegionsOfInterest(pending_roi_, pending_roi_space_);
+        }
+        
+        // Decode, resize and flip all write into pooled buffers, so the frame
+        // handed out is never touched again until the caller lets go of it
         cv::Mat bgr;
-        if (!getFrameInternal(bgr)) {
-            LOG_ERROR("Failed to read frame from stream");
+        if (!decodeFrame(bgr)) {
+            if (!interrupted_) {
+                LOG_ERROR("Failed to read frame from stream");
+            }
             return false;
         }
         
-        // Scale down if enabled
-        cv::Mat scaled;
-        if (enable_scaling_) {
-            cv::resize(bgr, scaled, cv::Size(scaled_width_, scaled_height_));
-        } else {
-            scaled = bgr;
+        // Scale down if enabled (only the remainder after DCT scaling, if any)
+        const cv::Size target = enable_scaling_ ? cv::Size(scaled_width_, scaled_height_)
+                                                : cv::Size(width_, height_);
+        cv::Mat scaled = bgr;
+        if (!native_output_ && enable_scaling_ && bgr.size() != target) {
+            scaled = frame_pool_.acquire(target, CV_8UC3);
+            cv::resize(bgr, scaled, target);
         }
         
         // Apply flip transformations if enabled
-        if (flip_horizontal_ && flip_vertical_) {
-            // Flip both horizontally and vertically (equivalent to 180 degree rotation)
-            cv::flip(scaled, frame, -1);
-        } else if (flip_horizontal_) {
-            // Flip horizontally (around y-axis)
-            cv::flip(scaled, frame, 1);
-        } else if (flip_vertical_) {
-            // Flip vertically (around x-axis)
-            cv::flip(scaled, frame, 0);
-        } else {
+        if (native_output_ || (!flip_horizontal_ && !flip_vertical_)) {
             frame = scaled;
+        } else {
+            frame = frame_pool_.acquire(scaled.size(), CV_8UC3);
+            if (flip_horizontal_ && flip_vertical_) {
+                // Flip both horizontally and vertically (equivalent to 180 degree rotation)
+                cv::flip(scaled, frame, -1);
+            } else if (flip_horizontal_) {
+                // Flip horizontally (around y-axis)
+                cv::flip(scaled, frame, 1);
+            } else {
+                // Flip vertically (around x-axis)
+                cv::flip(scaled, frame, 0);
+            }
         }
         
+        timing = frame_timing_;
+        timing.decoded = FrameTiming::Clock::now();
+        attachSensorTimestamp(timing);
         return true;
         
     } catch (const std::exception& e) {
@@ -276,19 +824,78 @@ void CameraFrameSource::release() {
     
     LOG_INFO("Releasing camera: " + device_);
     
-    if (camera_pipe_) {
-        pclose(camera_pipe_);
-        camera_pipe_ = nullptr;
+    stopCamera();
+    recorder_.close();
+    
+    LOG_INFO("Camera frame buffers: " + std::to_string(frame_pool_.size()) + " pooled, " +
+             std::to_string(frame_pool_.allocations()) + " allocations in total");
+    if (drain_to_newest_) {
+        LOG_INFO("Stale camera frames skipped without decoding: " + std::to_string(frames_skipped_.load()));
     }
     
-    frame_buffer_.clear();
+    if (total_restarts_ > 0) {
+        LOG_INFO("Camera was restarted " + std::to_string(total_restarts_.load()) + " time(s)");
+    }
+    
+    splitter_.reset();
     initialized_ = false;
 }
 
+void CameraFrameSource::setRegionsOfInterest(const std::vector<cv::Rect>& regions) {
+    if (codec_ == "yuv420") {
+        return;  // Nothing is decoded
+    }
+    if (!JpegDecoder::supportsRegionDecode()) {
+        LOG_INFO("ROI decoding not available (built without the libjpeg-turbo scanline API)");
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(roi_mutex_);
+    if (native_output_) {
+        // Frames are delivered as decoded, regions already match
+        pending_roi_ = regions;
+        pending_roi_space_ = cv::Size();
+        roi_pending_ = true;
+        return;
+    }
+    
+    // Regions are in output frame coordinates; decoding happens before the flip
+    const int frame_width = enable_scaling_ ? scaled_width_ : width_;
+    const int frame_height = enable_scaling_ ? scaled_height_ : height_;
+    
+    pending_roi_.clear();
+    pending_roi_.reserve(regions.size());
+    for (cv::Rect region : regions) {
+        if (flip_horizontal_) {
+            region.x = frame_width - region.x - region.width;
+        }
+        if (flip_vertical_) {
+            region.y = frame_height - region.y - region.height;
+        }
+        pending_roi_.push_back(region);
+    }
+    pending_roi_space_ = cv::Size(frame_width, frame_height);
+    roi_pending_ = true;
+}
+
+FrameSourceStats CameraFrameSource::getStats() const {
+    FrameSourceStats stats;
+    stats.frames_captured = frames_captured_.load();
+    stats.buffer_allocations = frame_pool_.allocations();
+    stats.restarts = static_cast<uint64_t>(total_restarts_.load());
+    stats.frames_skipped = frames_skipped_.load();
+    return stats;
+}
+
 std::string CameraFrameSource::getName() const {
     std::string name = "CameraFrameSource (rpicam-vid pipe): " + device_ + 
                        " (" + std::to_string(width_) + "x" + std::to_string(height_) + 
                        "@" + std::to_string(fps_) + "fps)";
+    if (codec_ == "yuv420") {
+        name += " [yuv420]";
+    } else if (native_output_) {
+        name += " [native geometry]";
+    }
     if (enable_scaling_) {
         name += " -> scaled to " + std::to_string(scaled_width_) + "x" + std::to_string(scaled_height_);
     }
@@ -302,7 +909,7 @@ std::string CameraFrameSource::getName() const {
 }
 
 bool CameraFrameSource::isReady() const {
-    return initialized_ && camera_pipe_ != nullptr;
+    return initialized_ && camera_fd_ >= 0;
 }
 
 } // namespace TVLED
@@ -1,4 +1,5 @@
 #include "core/Config.h"
+#include "core/SyntheticFrameSource.h"
 #include "utils/Logger.h"
 #include <fstream>
 #include <sstream>
@@ -74,6 +75,59 @@ bool Config::loadFromFile(const std::string& filename) {
             camera.enable_scaling = cam.value("enable_scaling", true);
             camera.scaled_width = cam.value("scaled_width", 820);
             camera.scaled_height = cam.value("scaled_height", 616);
+            
+            // Parse capture threading
+            camera.capture_thread = cam.value("capture_thread", true);
+            
+            // Parse stream format
+            camera.codec = cam.value("codec", "mjpeg");
+            camera.yuv_stride = cam.value("yuv_stride", 0);
+            
+            // Parse JPEG decode settings
+            camera.dct_scaling = cam.value("dct_scaling", true);
+            camera.fast_decode = cam.value("fast_decode", false);
+            camera.roi_decode = cam.value("roi_decode", true);
+            
+            // Parse camera process recovery settings
+            camera.stall_timeout_ms = cam.value("stall_timeout_ms", 1000);
+            camera.max_restarts = cam.value("max_restarts", 5);
+            camera.restart_delay_ms = cam.value("restart_delay_ms", 200);
+            camera.pipe_buffer_size = cam.value("pipe_buffer_size", 1048576);
+            camera.drain_to_newest = cam.value("drain_to_newest", false);
+            camera.sensor_timestamps = cam.value("sensor_timestamps", true);
+            camera.record_path = cam.value("record_path", "");
+        }
+        
+        // Parse replay settings
+        if (j.contains("replay")) {
+            auto rep = j["replay"];
+            replay.path = rep.value("path", "");
+            replay.realtime = rep.value("realtime", true);
+            replay.loop = rep.value("loop", false);
+        }
+        
+        // Parse synthetic frame settings
+        if (j.contains("synthetic")) {
+            auto syn = j["synthetic"];
+            synthetic.pattern = syn.value("pattern", "bars");
+            synthetic.width = syn.value("width", 1920);
+            synthetic.height = syn.value("height", 1080);
+            synthetic.fps = syn.value("fps", 0);
+        }
+        
+        // Parse shared-memory frame ring settings
+        if (j.contains("shm")) {
+            auto shm_cfg = j["shm"];
+            shm.name = shm_cfg.value("name", "/tvled-frames");
+            shm.timeout_ms = shm_cfg.value("timeout_ms", 2000);
+        }
+        
+        // Parse batch settings
+        if (j.contains("batch")) {
+            auto bat = j["batch"];
+            batch.input = bat.value("input", "");
+            batch.output = bat.value("output", "");
+            batch.threads = bat.value("threads", 0);
         }
         
         // Parse HyperHDR settings
@@ -144,6 +198,7 @@ bool Config::loadFromFile(const std::string& filename) {
             offset_y = scaling.value("offset_y", 0.0f);
             flip_horizontal = scaling.value("flip_horizontal", false);
             flip_vertical = scaling.value("flip_vertical", false);
+            transform_geometry = scaling.value("transform_geometry", false);
         }
         
         // Parse visualization settings
@@ -169,6 +224,9 @@ bool Config::loadFromFile(const std::string& filename) {
             performance.target_fps = perf.value("target_fps", 0);
             performance.enable_parallel_processing = perf.value("enable_parallel_processing", true);
             performance.parallel_chunk_size = perf.value("parallel_chunk_size", 4);
+            performance.worker_threads = perf.value("worker_threads", 0);
+            performance.pin_threads = perf.value("pin_threads", false);
+            performance.latency_report_frames = perf.value("latency_report_frames", 300);
         }
         
         // Parse color extraction settings
@@ -176,6 +234,15 @@ bool Config::loadFromFile(const std::string& filename) {
             auto ce = j["color_extraction"];
             color_extraction.mode = ce.value("mode", "edge_slices");
             color_extraction.method = ce.value("method", "dominant");
+            color_extraction.engine = ce.value("engine", "mask");
+            color_extraction.tile_kib = ce.value("tile_kib", 0);
+            color_extraction.dominant_bits = ce.value("dominant_bits", 3);
+            color_extraction.max_samples_per_led = ce.value("max_samples_per_led", 0);
+            color_extraction.sampling = ce.value("sampling", "blue_noise");
+            color_extraction.change_detection = ce.value("change_detection", false);
+            color_extraction.change_block_size = ce.value("change_block_size", 16);
+            color_extraction.change_threshold = ce.value("change_threshold", 1.0f);
+            color_extraction.change_refresh_frames = ce.value("change_refresh_frames", 60);
             color_extraction.horizontal_coverage_percent = ce.value("horizontal_coverage_percent", 20.0f);
             color_extraction.vertical_coverage_percent = ce.value("vertical_coverage_percent", 20.0f);
             color_extraction.horizontal_slices = ce.value("horizontal_slices", 10);
@@ -331,6 +398,35 @@ bool Config::saveToFile(const std::string& filename) const {
         j["camera"]["enable_scaling"] = camera.enable_scaling;
         j["camera"]["scaled_width"] = camera.scaled_width;
         j["camera"]["scaled_height"] = camera.scaled_height;
+        j["camera"]["capture_thread"] = camera.capture_thread;
+        j["camera"]["codec"] = camera.codec;
+        j["camera"]["yuv_stride"] = camera.yuv_stride;
+        j["camera"]["dct_scaling"] = camera.dct_scaling;
+        j["camera"]["fast_decode"] = camera.fast_decode;
+        j["camera"]["roi_decode"] = camera.roi_decode;
+        j["camera"]["stall_timeout_ms"] = camera.stall_timeout_ms;
+        j["camera"]["max_restarts"] = camera.max_restarts;
+        j["camera"]["restart_delay_ms"] = camera.restart_delay_ms;
+        j["camera"]["pipe_buffer_size"] = camera.pipe_buffer_size;
+        j["camera"]["drain_to_newest"] = camera.drain_to_newest;
+        j["camera"]["sensor_timestamps"] = camera.sensor_timestamps;
+        j["camera"]["record_path"] = camera.record_path;
+        
+        j["replay"]["path"] = replay.path;
+        j["replay"]["realtime"] = replay.realtime;
+        j["replay"]["loop"] = replay.loop;
+        
+        j["synthetic"]["pattern"] = synthetic.pattern;
+        j["synthetic"]["width"] = synthetic.width;
+        j["synthetic"]["height"] = synthetic.height;
+        j["synthetic"]["fps"] = synthetic.fps;
+        
+        j["shm"]["name"] = shm.name;
+        j["shm"]["timeout_ms"] = shm.timeout_ms;
+        
+        j["batch"]["input"] = batch.input;
+        j["batch"]["output"] = batch.output;
+        j["batch"]["threads"] = batch.threads;
         
         j["hyperhdr"]["enabled"] = hyperhdr.enabled;
         j["hyperhdr"]["host"] = hyperhdr.host;
@@ -364,6 +460,7 @@ bool Config::saveToFile(const std::string& filename) const {
         j["scaling"]["offset_y"] = offset_y;
         j["scaling"]["flip_horizontal"] = flip_horizontal;
         j["scaling"]["flip_vertical"] = flip_vertical;
+        j["scaling"]["transform_geometry"] = transform_geometry;
         
         j["visualization"]["grid_cell_width"] = visualization.grid_cell_width;
         j["visualization"]["grid_cell_height"] = visualization.grid_cell_height;
@@ -377,9 +474,21 @@ bool Config::saveToFile(const std::string& filename) const {
         j["performance"]["target_fps"] = performance.target_fps;
         j["performance"]["enable_parallel_processing"] = performance.enable_parallel_processing;
         j["performance"]["parallel_chunk_size"] = performance.parallel_chunk_size;
+        j["performance"]["worker_threads"] = performance.worker_threads;
+        j["performance"]["pin_threads"] = performance.pin_threads;
+        j["performance"]["latency_report_frames"] = performance.latency_report_frames;
         
         j["color_extraction"]["mode"] = color_extraction.mode;
         j["color_extraction"]["method"] = color_extraction.method;
+        j["color_extraction"]["engine"] = color_extraction.engine;
+        j["color_extraction"]["tile_kib"] = color_extraction.tile_kib;
+        j["color_extraction"]["dominant_bits"] = color_extraction.dominant_bits;
+        j["color_extraction"]["max_samples_per_led"] = color_extraction.max_samples_per_led;
+        j["color_extraction"]["sampling"] = color_extraction.sampling;
+        j["color_extraction"]["change_detection"] = color_extraction.change_detection;
+        j["color_extraction"]["change_block_size"] = color_extraction.change_block_size;
+        j["color_extraction"]["change_threshold"] = color_extraction.change_threshold;
+        j["color_extraction"]["change_refresh_frames"] = color_extraction.change_refresh_frames;
         j["color_extraction"]["horizontal_coverage_percent"] = color_extraction.horizontal_coverage_percent;
         j["color_extraction"]["vertical_coverage_percent"] = color_extraction.vertical_coverage_percent;
         j["color_extraction"]["horizontal_slices"] = color_extraction.horizontal_slices;
@@ -432,8 +541,36 @@ bool Config::saveToFile(const std::string& filename) const {
 bool Config::validate() const {
     bool valid = true;
     
-    if (mode != "debug" && mode != "live") {
-        LOG_ERROR("Invalid mode: " + mode + " (must be 'debug' or 'live')");
+    if (mode != "debug" && mode != "live" && mode != "replay" && mode != "synthetic" && mode != "shm" &&
+        mode != "batch") {
+        LOG_ERROR("Invalid mode: " + mode + " (must be 'debug', 'live', 'replay', 'synthetic', 'shm' or 'batch')");
+        valid = false;
+    }
+    
+    if (mode == "replay" && replay.path.empty()) {
+        LOG_ERROR("Replay mode requires replay.path to be specified");
+        valid = false;
+    }
+    
+    if (mode == "synthetic") {
+        if (!SyntheticFrameSource::isValidPattern(synthetic.pattern)) {
+            LOG_ERROR("Invalid synthetic pattern: " + synthetic.pattern +
+                      " (must be 'gradient', 'bars', 'noise', 'letterbox' or 'static')");
+            valid = false;
+        }
+        if (synthetic.width <= 0 || synthetic.height <= 0 || synthetic.fps < 0) {
+            LOG_ERROR("Synthetic width/height must be positive and fps not negative");
+            valid = false;
+        }
+    }
+    
+    if (mode == "shm" && (shm.name.empty() || shm.timeout_ms <= 0)) {
+        LOG_ERROR("Shm mode requires shm.name and a positive shm.timeout_ms");
+        valid = false;
+    }
+    
+    if (mode == "batch" && (batch.input.empty() || batch.threads < 0)) {
+        LOG_ERROR("Batch mode requires batch.input and a non-negative batch.threads");
         valid = false;
     }
     
@@ -442,6 +579,36 @@ bool Config::validate() const {
         valid = false;
     }
     
+    if (camera.codec != "mjpeg" && camera.codec != "yuv420") {
+        LOG_ERROR("Invalid camera codec: " + camera.codec + " (must be 'mjpeg' or 'yuv420')");
+        valid = false;
+    }
+    
+    if (camera.yuv_stride < 0) {
+        LOG_ERROR("Camera yuv_stride must be 0 (auto) or a positive row stride");
+        valid = false;
+    }
+    
+    if (performance.latency_report_frames < 0) {
+        LOG_ERROR("Performance latency_report_frames must be 0 (off) or positive");
+        valid = false;
+    }
+    
+    if (performance.worker_threads < 0) {
+        LOG_ERROR("Performance worker_threads must be 0 (one per core) or positive");
+        valid = false;
+    }
+    
+    if (camera.stall_timeout_ms <= 0) {
+        LOG_ERROR("Camera stall_timeout_ms must be positive");
+        valid = false;
+    }
+    
+    if (camera.max_restarts < 0 || camera.restart_delay_ms < 0 || camera.pipe_buffer_size < 0) {
+        LOG_ERROR("Camera max_restarts, restart_delay_ms and pipe_buffer_size must not be negative");
+        valid = false;
+    }
+    
     if (bezier.left_bezier.empty() || bezier.bottom_bezier.empty() ||
         bezier.right_bezier.empty() || bezier.top_bezier.empty()) {
         LOG_ERROR("All four bezier curves must be specified");
@@ -470,6 +637,44 @@ bool Config::validate() const {
         valid = false;
     }
     
+    if (color_extraction.engine != "mask" && color_extraction.engine != "integral" &&
+        color_extraction.engine != "label_map" && color_extraction.engine != "tiled") {
+        LOG_ERROR("Invalid color extraction engine: " + color_extraction.engine +
+                  " (must be 'mask', 'integral', 'label_map' or 'tiled')");
+        valid = false;
+    }
+    
+    if (color_extraction.tile_kib < 0) {
+        LOG_ERROR("Color extraction tile_kib must be >= 0 (0 = half the L2 cache)");
+        valid = false;
+    }
+    
+    if (color_extraction.dominant_bits < 3 || color_extraction.dominant_bits > 5) {
+        LOG_ERROR("Color extraction dominant_bits must be 3, 4 or 5");
+        valid = false;
+    }
+    
+    if (color_extraction.max_samples_per_led < 0) {
+        LOG_ERROR("Color extraction max_samples_per_led must be >= 0 (0 = all pixels)");
+        valid = false;
+    }
+    
+    if (color_extraction.sampling != "stride" && color_extraction.sampling != "blue_noise") {
+        LOG_ERROR("Invalid color extraction sampling: " + color_extraction.sampling +
+                  " (must be 'stride' or 'blue_noise')");
+        valid = false;
+    }
+    
+    if (color_extraction.change_block_size < 4 || color_extraction.change_block_size > 256) {
+        LOG_ERROR("Color extraction change_block_size must be between 4 and 256");
+        valid = false;
+    }
+    
+    if (color_extraction.change_threshold < 0 || color_extraction.change_refresh_frames < 0) {
+        LOG_ERROR("Color extraction change_threshold and change_refresh_frames must be >= 0");
+        valid = false;
+    }
+    
     if (color_extraction.horizontal_coverage_percent < 0 || 
         color_extraction.horizontal_coverage_percent > 100) {
         LOG_ERROR("Horizontal coverage percent must be between 0 and 100");
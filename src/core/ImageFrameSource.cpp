@@ -23,7 +23,7 @@ bool ImageFrameSource::initialize() {
     return true;
 }
 
-bool ImageFrameSource::getFrame(cv::Mat& frame) {
+bool ImageFrameSource::getFrame(cv::Mat& frame, FrameTiming& timing) {
     if (!initialized_) {
         LOG_ERROR("ImageFrameSource not initialized");
         return false;
@@ -31,6 +31,7 @@ bool ImageFrameSource::getFrame(cv::Mat& frame) {
     
     // Return a copy of the image
     frame = image_.clone();
+    timing.stampAll();
     return true;
 }
 
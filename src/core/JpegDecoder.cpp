@@ -0,0 +1,415 @@
+#include "core/JpegDecoder.h"
+#include "utils/Logger.h"
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <cmath>
+
+#ifdef HAVE_JPEG_ROI_DECODE
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+#endif
+
+namespace TVLED {
+
+namespace {
+    // Output dimension of libjpeg DCT scaling (rounds up, like TJSCALED)
+    inline int scaledDimension(int dim, int denom) {
+        return (dim + denom - 1) / denom;
+    }
+
+    // Relative decode cost per MCU. Huffman decoding cannot be skipped: every
+    // pass entropy-decodes all MCUs of every row up to the last one it reads.
+    // IDCT, upsampling and color conversion only run for the cropped MCUs of
+    // the rows actually read. Each pass also re-parses headers and sets up the
+    // decompressor, counted as one full MCU row. Weights measured with
+    // libjpeg-turbo at 1/2 scale, where the reduced IDCT makes entropy
+    // decoding the larger share.
+    constexpr double kEntropyCostPerMCU = 0.6;
+    constexpr double kPixelCostPerMCU = 0.4;
+    constexpr double kPassOverheadRows = 1.0;
+
+    // Candidate pass on the MCU grid: column range [c0, c1) and the MCU rows read
+    struct PassCandidate {
+        int c0;
+        int c1;
+        std::vector<char> rows;
+    };
+
+    double passCost(const PassCandidate& pass, int mcu_cols) {
+        int last_row = -1;
+        int row_count = 0;
+        for (int r = 0; r < static_cast<int>(pass.rows.size()); r++) {
+            if (pass.rows[r]) {
+                last_row = r;
+                row_count++;
+            }
+        }
+        return kEntropyCostPerMCU * mcu_cols * (last_row + 1 + kPassOverheadRows) +
+               kPixelCostPerMCU * (pass.c1 - pass.c0) * row_count;
+    }
+
+    PassCandidate mergePasses(const PassCandidate& a, const PassCandidate& b) {
+        PassCandidate merged{std::min(a.c0, b.c0), std::max(a.c1, b.c1), a.rows};
+        for (size_t r = 0; r < merged.rows.size(); r++) {
+            merged.rows[r] |= b.rows[r];
+        }
+        return merged;
+    }
+}
+
+#ifdef HAVE_JPEG_ROI_DECODE
+// libjpeg reports errors through a callback that must not return
+struct JpegDecoder::LibjpegState {
+    jpeg_decompress_struct cinfo;
+    jpeg_error_mgr err;
+    jmp_buf jump;
+
+    static void errorExit(j_common_ptr cinfo) {
+        longjmp(static_cast<LibjpegState*>(cinfo->client_data)->jump, 1);
+    }
+
+    // Corrupt-data warnings are routine in camera MJPEG, keep them off stderr
+    static void outputMessage(j_common_ptr) {}
+};
+#endif
+
+JpegDecoder::JpegDecoder()
+    : target_width_(0), target_height_(0), fast_decode_(false), scale_denom_(1) {
+#ifdef HAVE_TURBOJPEG
+    handle_ = tjInitDecompress();
+    if (!handle_) {
+        LOG_WARN("Failed to create TurboJPEG decompressor, falling back to OpenCV: " +
+                 std::string(tjGetErrorStr2(nullptr)));
+    }
+#endif
+#ifdef HAVE_JPEG_ROI_DECODE
+    libjpeg_ = std::make_unique<LibjpegState>();
+    libjpeg_->cinfo.err = jpeg_std_error(&libjpeg_->err);
+    libjpeg_->err.error_exit = &LibjpegState::errorExit;
+    libjpeg_->err.output_message = &LibjpegState::outputMessage;
+    libjpeg_->cinfo.client_data = libjpeg_.get();
+    jpeg_create_decompress(&libjpeg_->cinfo);
+#endif
+}
+
+JpegDecoder::~JpegDecoder() {
+#ifdef HAVE_TURBOJPEG
+    if (handle_) {
+        tjDestroy(handle_);
+    }
+#endif
+#ifdef HAVE_JPEG_ROI_DECODE
+    jpeg_destroy_decompress(&libjpeg_->cinfo);
+#endif
+}
+
+void JpegDecoder::setTargetSize(int width, int height) {
+    target_width_ = width;
+    target_height_ = height;
+    scale_denom_ = 1;
+    planned_size_ = cv::Size();
+}
+
+void JpegDecoder::setRegionsOfInterest(const std::vector<cv::Rect>& regions, cv::Size region_space) {
+    regions_ = regions;
+    region_space_ = region_space;
+    passes_.clear();
+    planned_size_ = cv::Size();
+}
+
+bool JpegDecoder::usesTurboJPEG() const {
+#ifdef HAVE_TURBOJPEG
+    return handle_ != nullptr;
+#else
+    return false;
+#endif
+}
+
+bool JpegDecoder::supportsRegionDecode() {
+#ifdef HAVE_JPEG_ROI_DECODE
+    return true;
+#else
+    return false;
+#endif
+}
+
+int JpegDecoder::chooseScaleDenominator(int jpeg_width, int jpeg_height) const {
+    if (target_width_ <= 0 || target_height_ <= 0) {
+        return 1;
+    }
+
+    for (int denom : {8, 4, 2}) {
+        if (scaledDimension(jpeg_width, denom) >= target_width_ &&
+            scaledDimension(jpeg_height, denom) >= target_height_) {
+            return denom;
+        }
+    }
+    return 1;
+}
+
+void JpegDecoder::planRegionPasses(int out_width, int out_height, int mcu_width, int mcu_height) {
+    passes_.clear();
+    planned_size_ = cv::Size(out_width, out_height);
+
+    const int mcu_cols = (out_width + mcu_width - 1) / mcu_width;
+    const int mcu_rows = (out_height + mcu_height - 1) / mcu_height;
+
+    // Regions may be given for a differently sized (resized) frame, so widen
+    // by the interpolation footprint. One extra pixel also keeps crop edges
+    // (where fancy upsampling has no neighbor) away from the pixels sampled.
+    const int space_width = region_space_.width > 0 ? region_space_.width : out_width;
+    const int space_height = region_space_.height > 0 ? region_space_.height : out_height;
+    const double sx = static_cast<double>(out_width) / space_width;
+    const double sy = static_cast<double>(out_height) / space_height;
+    const int margin = (out_width == space_width && out_height == space_height) ? 1 : 2;
+
+    std::vector<char> covered(static_cast<size_t>(mcu_cols) * mcu_rows, 0);
+    for (const auto& region : regions_) {
+        if (region.width <= 0 || region.height <= 0) {
+            continue;
+        }
+        int x0 = std::max(0, static_cast<int>(std::floor(region.x * sx)) - margin);
+        int y0 = std::max(0, static_cast<int>(std::floor(region.y * sy)) - margin);
+        int x1 = std::min(out_width, static_cast<int>(std::ceil((region.x + region.width) * sx)) + margin);
+        int y1 = std::min(out_height, static_cast<int>(std::ceil((region.y + region.height) * sy)) + margin);
+        if (x0 >= x1 || y0 >= y1) {
+            continue;
+        }
+        for (int r = y0 / mcu_height; r <= (y1 - 1) / mcu_height; r++) {
+            std::fill(covered.begin() + static_cast<size_t>(r) * mcu_cols + x0 / mcu_width,
+                      covered.begin() + static_cast<size_t>(r) * mcu_cols + (x1 - 1) / mcu_width + 1, 1);
+        }
+    }
+
+    // One candidate pass per distinct column run, collecting the rows it occurs in
+    std::vector<PassCandidate> candidates;
+    for (int r = 0; r < mcu_rows; r++) {
+        const char* row = &covered[static_cast<size_t>(r) * mcu_cols];
+        int c = 0;
+        while (c < mcu_cols) {
+            if (!row[c]) {
+                c++;
+                continue;
+            }
+            int run_start = c;
+            while (c < mcu_cols && row[c]) {
+                c++;
+            }
+            auto it = std::find_if(candidates.begin(), candidates.end(), [&](const PassCandidate& p) {
+                return p.c0 == run_start && p.c1 == c;
+            });
+            if (it == candidates.end()) {
+                candidates.push_back(PassCandidate{run_start, c, std::vector<char>(mcu_rows, 0)});
+                it = candidates.end() - 1;
+            }
+            it->rows[r] = 1;
+        }
+    }
+
+    // Greedily merge the pair of passes that saves the most, until nothing saves
+    while (candidates.size() > 1) {
+        double best_gain = 0.0;
+        size_t best_i = 0, best_j = 0;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            for (size_t j = i + 1; j < candidates.size(); j++) {
+                double gain = passCost(candidates[i], mcu_cols) + passCost(candidates[j], mcu_cols) -
+                              passCost(mergePasses(candidates[i], candidates[j]), mcu_cols);
+                if (gain > best_gain) {
+                    best_gain = gain;
+                    best_i = i;
+                    best_j = j;
+                }
+            }
+        }
+        if (best_gain <= 0.0) {
+            break;
+        }
+        candidates[best_i] = mergePasses(candidates[best_i], candidates[best_j]);
+        candidates.erase(candidates.begin() + best_j);
+    }
+
+    double planned_cost = 0.0;
+    for (const auto& candidate : candidates) {
+        planned_cost += passCost(candidate, mcu_cols);
+    }
+    PassCandidate full{0, mcu_cols, std::vector<char>(mcu_rows, 1)};
+    if (candidates.empty() || planned_cost >= passCost(full, mcu_cols)) {
+        candidates.assign(1, full);
+    }
+
+    // Convert to pixel ranges, merging consecutive MCU rows
+    for (const auto& candidate : candidates) {
+        DecodePass pass{candidate.c0 * mcu_width, std::min(out_width, candidate.c1 * mcu_width), {}};
+        for (int r = 0; r < mcu_rows; r++) {
+            if (!candidate.rows[r]) {
+                continue;
+            }
+            int first = r * mcu_height;
+            int last = std::min(out_height, (r + 1) * mcu_height);
+            if (!pass.rows.empty() && pass.rows.back().second == first) {
+                pass.rows.back().second = last;
+            } else {
+                pass.rows.emplace_back(first, last);
+            }
+        }
+        passes_.push_back(std::move(pass));
+    }
+
+    double full_cost = passCost(full, mcu_cols);
+    LOG_INFO("ROI decode plan: " + std::to_string(passes_.size()) + " pass(es), estimated " +
+             std::to_string(static_cast<int>(100.0 * std::min(planned_cost, full_cost) / full_cost)) +
+             "% of a full decode");
+}
+
+#ifdef HAVE_JPEG_ROI_DECODE
+bool JpegDecoder::decodeRegions(const uint8_t* data, size_t size, cv::Mat& frame) {
+    jpeg_decompress_struct& cinfo = libjpeg_->cinfo;
+
+    if (setjmp(libjpeg_->jump)) {
+        jpeg_abort_decompress(&cinfo);
+        LOG_WARN("Failed to decode JPEG regions");
+        return false;
+    }
+
+    // Every pass restarts decompression from the header
+    auto read_header = [&]() {
+        jpeg_mem_src(&cinfo, data, static_cast<unsigned long>(size));
+        jpeg_read_header(&cinfo, TRUE);
+
+        scale_denom_ = chooseScaleDenominator(static_cast<int>(cinfo.image_width),
+                                              static_cast<int>(cinfo.image_height));
+        cinfo.scale_num = 1;
+        cinfo.scale_denom = static_cast<unsigned int>(scale_denom_);
+        cinfo.out_color_space = JCS_EXT_BGR;
+        if (fast_decode_) {
+            cinfo.dct_method = JDCT_IFAST;
+            cinfo.do_fancy_upsampling = FALSE;
+        }
+    };
+
+    read_header();
+    jpeg_calc_output_dimensions(&cinfo);
+    const int out_width = static_cast<int>(cinfo.output_width);
+    const int out_height = static_cast<int>(cinfo.output_height);
+    if (planned_size_ != cv::Size(out_width, out_height)) {
+#if JPEG_LIB_VERSION >= 70
+        const int dct_size = cinfo.min_DCT_h_scaled_size;
+#else
+        const int dct_size = cinfo.min_DCT_scaled_size;
+#endif
+        planRegionPasses(out_width, out_height,
+                         cinfo.max_h_samp_factor * dct_size, cinfo.max_v_samp_factor * dct_size);
+    }
+
+    // Pixels outside the regions are never written, only clear fresh buffers
+    const uchar* previous = frame.data;
+    frame.create(out_height, out_width, CV_8UC3);
+    if (frame.data != previous) {
+        frame.setTo(cv::Scalar::all(0));
+    }
+
+    for (size_t p = 0; p < passes_.size(); p++) {
+        if (p > 0) {
+            read_header();
+        }
+
+        const DecodePass& pass = passes_[p];
+        jpeg_start_decompress(&cinfo);
+
+        JDIMENSION x_offset = static_cast<JDIMENSION>(pass.x0);
+        JDIMENSION width = static_cast<JDIMENSION>(pass.x1 - pass.x0);
+        if (width < cinfo.output_width) {
+            // Widens to iMCU boundaries, which the plan already respects
+            jpeg_crop_scanline(&cinfo, &x_offset, &width);
+        }
+
+        for (const auto& range : pass.rows) {
+            const JDIMENSION first = static_cast<JDIMENSION>(range.first);
+            const JDIMENSION last = static_cast<JDIMENSION>(range.second);
+            if (cinfo.output_scanline < first) {
+                jpeg_skip_scanlines(&cinfo, first - cinfo.output_scanline);
+            }
+            while (cinfo.output_scanline < last) {
+                JSAMPROW row = frame.ptr<uchar>(static_cast<int>(cinfo.output_scanline)) + x_offset * 3;
+                jpeg_read_scanlines(&cinfo, &row, 1);
+            }
+        }
+
+        // Rows below the last region are never entropy-decoded
+        jpeg_abort_decompress(&cinfo);
+    }
+
+    output_size_ = frame.size();
+    return true;
+}
+#endif
+
+bool JpegDecoder::decode(const uint8_t* data, size_t size, cv::Mat& frame) {
+#ifdef HAVE_JPEG_ROI_DECODE
+    if (!regions_.empty()) {
+        return decodeRegions(data, size, frame);
+    }
+#endif
+
+#ifdef HAVE_TURBOJPEG
+    if (handle_) {
+        int width = 0, height = 0, subsamp = 0, colorspace = 0;
+        if (tjDecompressHeader3(handle_, data, static_cast<unsigned long>(size),
+                                &width, &height, &subsamp, &colorspace) != 0) {
+            LOG_WARN("Failed to read JPEG header: " + std::string(tjGetErrorStr2(handle_)));
+            return false;
+        }
+
+        scale_denom_ = chooseScaleDenominator(width, height);
+        const int out_width = scaledDimension(width, scale_denom_);
+        const int out_height = scaledDimension(height, scale_denom_);
+
+        frame.create(out_height, out_width, CV_8UC3);
+
+        int flags = fast_decode_ ? (TJFLAG_FASTDCT | TJFLAG_FASTUPSAMPLE) : 0;
+        if (tjDecompress2(handle_, data, static_cast<unsigned long>(size), frame.data,
+                          out_width, static_cast<int>(frame.step), out_height,
+                          TJPF_BGR, flags) != 0) {
+            // Warnings (e.g. a truncated scan) still produce a usable image
+            if (tjGetErrorCode(handle_) != TJERR_WARNING) {
+                LOG_WARN("Failed to decode JPEG: " + std::string(tjGetErrorStr2(handle_)));
+                return false;
+            }
+        }
+        output_size_ = frame.size();
+        return true;
+    }
+#endif
+
+    // OpenCV path: the header is not exposed, so derive the reduction from the
+    // first frame's full size and keep it (camera resolution never changes)
+    int mode = cv::IMREAD_COLOR;
+    switch (scale_denom_) {
+        case 2: mode = cv::IMREAD_REDUCED_COLOR_2; break;
+        case 4: mode = cv::IMREAD_REDUCED_COLOR_4; break;
+        case 8: mode = cv::IMREAD_REDUCED_COLOR_8; break;
+        default: break;
+    }
+
+    // Wrap the span without copying, imdecode reads it in place and decodes
+    // into frame's buffer when the size matches
+    cv::Mat encoded(1, static_cast<int>(size), CV_8UC1, const_cast<uint8_t*>(data));
+    cv::imdecode(encoded, mode, &frame);
+    if (frame.empty()) {
+        return false;
+    }
+
+    if (scale_denom_ == 1) {
+        int denom = chooseScaleDenominator(frame.cols, frame.rows);
+        if (denom != 1) {
+            scale_denom_ = denom;
+            LOG_INFO("JPEG decode scaled 1/" + std::to_string(denom) + " in the DCT domain");
+        }
+    }
+
+    output_size_ = frame.size();
+    return true;
+}
+
+} // namespace TVLED
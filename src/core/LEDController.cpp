@@ -1,18 +1,30 @@
 #include "core/LEDController.h"
 #include "core/ImageFrameSource.h"
 #include "core/CameraFrameSource.h"
+#include "core/ReplayFrameSource.h"
+#include "core/SyntheticFrameSource.h"
+#include "core/ShmFrameSource.h"
+#include "core/ThreadedFrameSource.h"
 #include "utils/Logger.h"
 #include "utils/PerformanceTimer.h"
 #include <filesystem>
+#include <fstream>
 #include <thread>
 #include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
 
 namespace fs = std::filesystem;
 
 namespace TVLED {
 
 LEDController::LEDController(const Config& config)
-    : config_(config), running_(false), initialized_(false) {
+    : config_(config), native_geometry_(false), running_(false), initialized_(false) {
 }
 
 LEDController::~LEDController() {
@@ -48,15 +60,15 @@ bool LEDController::initialize() {
         return false;
     }
     
-    // Setup HyperHDR client (optional)
-    if (config_.hyperhdr.enabled) {
+    // Setup HyperHDR client (optional, batch mode only writes a timeline)
+    if (config_.hyperhdr.enabled && config_.mode != "batch") {
         if (!setupHyperHDRClient()) {
             LOG_WARN("Failed to setup HyperHDR client, continuing without it");
         }
     }
     
     // Setup USB controller (optional)
-    if (config_.usb.enabled) {
+    if (config_.usb.enabled && config_.mode != "batch") {
         if (!setupUSBController()) {
             LOG_WARN("Failed to setup USB controller, continuing without it");
         }
@@ -73,7 +85,10 @@ bool LEDController::setupFrameSource() {
     if (config_.mode == "debug") {
         frame_source_ = std::make_unique<ImageFrameSource>(config_.input_image);
     } else if (config_.mode == "live") {
-        frame_source_ = std::make_unique<CameraFrameSource>(
+        // The ISP already scales and flips yuv420 frames, nothing left to fold in
+        native_geometry_ = config_.transform_geometry && config_.camera.codec != "yuv420";
+        
+        auto camera = std::make_unique<CameraFrameSource>(
             config_.camera.device,
             config_.camera.width,
             config_.camera.height,
@@ -93,8 +108,69 @@ bool LEDController::setupFrameSource() {
             config_.camera.scaled_width,
             config_.camera.scaled_height,
             config_.flip_horizontal,
-            config_.flip_vertical
+            config_.flip_vertical,
+            config_.camera.codec,
+            config_.camera.yuv_stride,
+            config_.camera.dct_scaling,
+            config_.camera.fast_decode,
+            native_geometry_
         );
+        camera->setRecoveryOptions(config_.camera.stall_timeout_ms,
+                                   config_.camera.max_restarts,
+                                   config_.camera.restart_delay_ms,
+                                   config_.camera.pipe_buffer_size);
+        camera->setRecordPath(config_.camera.record_path);
+        camera->setSensorTimestamps(config_.camera.sensor_timestamps);
+        camera->setDrainToNewest(config_.camera.drain_to_newest);
+        
+        // Decode on a capture thread so capture overlaps extraction and sending
+        if (config_.camera.capture_thread) {
+            frame_source_ = std::make_unique<ThreadedFrameSource>(std::move(camera));
+        } else {
+            frame_source_ = std::move(camera);
+        }
+    } else if (config_.mode == "replay") {
+        // Recordings are always MJPEG, decoded like live camera frames
+        native_geometry_ = config_.transform_geometry;
+        
+        auto replay = std::make_unique<ReplayFrameSource>(
+            config_.replay.path,
+            config_.replay.realtime,
+            config_.replay.loop,
+            config_.camera.width,
+            config_.camera.height,
+            config_.camera.fps,
+            config_.camera.enable_scaling,
+            config_.camera.scaled_width,
+            config_.camera.scaled_height,
+            config_.flip_horizontal,
+            config_.flip_vertical,
+            config_.camera.dct_scaling,
+            config_.camera.fast_decode,
+            native_geometry_
+        );
+        
+        // As fast as possible means every frame gets processed: a capture
+        // thread would drop frames whenever decode outruns processing
+        if (config_.camera.capture_thread && config_.replay.realtime) {
+            frame_source_ = std::make_unique<ThreadedFrameSource>(std::move(replay));
+        } else {
+            frame_source_ = std::move(replay);
+        }
+    } else if (config_.mode == "synthetic") {
+        frame_source_ = std::make_unique<SyntheticFrameSource>(
+            config_.synthetic.pattern,
+            config_.synthetic.width,
+            config_.synthetic.height,
+            config_.synthetic.fps
+        );
+    } else if (config_.mode == "batch") {
+        // runBatch() reads the video itself, frames are transformed like camera frames
+        LOG_INFO("Batch mode: frames come from " + config_.batch.input);
+        return true;
+    } else if (config_.mode == "shm") {
+        // Frames are consumed in place from the ring, a capture thread would only add a hop
+        frame_source_ = std::make_unique<ShmFrameSource>(config_.shm.name, config_.shm.timeout_ms);
     } else {
         LOG_ERROR("Unknown mode: " + config_.mode);
         return false;
@@ -140,6 +216,15 @@ bool LEDController::setupBezierCurves() {
 bool LEDController::setupCoonsPatching(int imageWidth, int imageHeight) {
     LOG_INFO("Setting up Coons patching...");
     
+    // With native geometry the geometry is laid out in the configured
+    // (scaled, flipped) frame as usual and then mapped into the camera frame
+    const cv::Size native_size(imageWidth, imageHeight);
+    if (native_geometry_) {
+        cv::Size logical = logicalFrameSize();
+        imageWidth = logical.width;
+        imageHeight = logical.height;
+    }
+    
     // Get bezier points
     auto top_pts = top_bezier_.getPoints();
     auto right_pts = right_bezier_.getPoints();
@@ -333,23 +418,93 @@ bool LEDController::setupCoonsPatching(int imageWidth, int imageHeight) {
                  std::to_string(timer.elapsedMilliseconds()) + " ms");
     }
     
+    if (native_geometry_) {
+        mapPolygonsToNativeFrame(cv::Size(imageWidth, imageHeight), native_size);
+    }
+    
     // Pre-compute masks for optimal performance (masks don't change between frames)
     if (color_extractor_ && !cell_polygons_.empty()) {
-        color_extractor_->precomputeMasks(cell_polygons_, imageWidth, imageHeight);
+        color_extractor_->precomputeMasks(cell_polygons_, native_size.width, native_size.height);
+        
+        // Let the camera skip decoding what extraction never reads
+        if (frame_source_ && config_.camera.roi_decode) {
+            frame_source_->setRegionsOfInterest(color_extractor_->getCachedBoundingBoxes());
+        }
     }
     
     return true;
 }
 
-bool LEDController::setupColorExtractor() {
-    LOG_INFO("Setting up color extractor...");
+cv::Size LEDController::logicalFrameSize() const {
+    if (config_.camera.enable_scaling) {
+        return cv::Size(config_.camera.scaled_width, config_.camera.scaled_height);
+    }
+    return cv::Size(config_.camera.width, config_.camera.height);
+}
+
+void LEDController::mapPolygonsToNativeFrame(const cv::Size& logical, const cv::Size& native) {
+    // Inverse of what the camera used to do per frame: flip (pixel x -> W-1-x),
+    // then resize (pixel centers scale as (x + 0.5) * s - 0.5)
+    const float sx = static_cast<float>(native.width) / logical.width;
+    const float sy = static_cast<float>(native.height) / logical.height;
+    
+    for (auto& polygon : cell_polygons_) {
+        for (auto& pt : polygon) {
+            int x = config_.flip_horizontal ? logical.width - 1 - pt.x : pt.x;
+            int y = config_.flip_vertical ? logical.height - 1 - pt.y : pt.y;
+            x = static_cast<int>(std::lround((x + 0.5f) * sx - 0.5f));
+            y = static_cast<int>(std::lround((y + 0.5f) * sy - 0.5f));
+            pt.x = std::min(std::max(x, 0), native.width - 1);
+            pt.y = std::min(std::max(y, 0), native.height - 1);
+        }
+    }
     
-    color_extractor_ = std::make_unique<ColorExtractor>();
-    color_extractor_->setParallelProcessing(config_.performance.enable_parallel_processing);
-    color_extractor_->setMethod(config_.color_extraction.method);
+    LOG_INFO("Mapped polygons into native " + std::to_string(native.width) + "x" +
+             std::to_string(native.height) + " camera frame (logical " +
+             std::to_string(logical.width) + "x" + std::to_string(logical.height) + ")");
+}
+
+cv::Mat LEDController::toLogicalFrame(const cv::Mat& frame) const {
+    // Only needed for debug output, the hot path never transforms frames
+    cv::Mat logical;
+    cv::resize(frame, logical, logicalFrameSize());
+    if (config_.flip_horizontal || config_.flip_vertical) {
+        int code = config_.flip_horizontal && config_.flip_vertical ? -1 : (config_.flip_horizontal ? 1 : 0);
+        cv::flip(logical, logical, code);
+    }
+    return logical;
+}
+
+void LEDController::configureColorExtractor(ColorExtractor& extractor) const {
+    extractor.setParallelProcessing(config_.performance.enable_parallel_processing,
+                                    config_.performance.worker_threads,
+                                    config_.performance.pin_threads);
+    extractor.setMethod(config_.color_extraction.method);
+    extractor.setDominantBits(config_.color_extraction.dominant_bits);
+    extractor.setEngine(config_.color_extraction.engine);
+    extractor.setTileBytes(static_cast<size_t>(config_.color_extraction.tile_kib) * 1024);
+    extractor.setSampling(config_.color_extraction.max_samples_per_led, config_.color_extraction.sampling);
+    extractor.setChangeDetection(config_.color_extraction.change_detection,
+                                 config_.color_extraction.change_block_size,
+                                 config_.color_extraction.change_threshold,
+                                 config_.color_extraction.change_refresh_frames);
+    
+    // Raw yuv420 camera frames are extracted from the planes directly.
+    // rpicam-vid uses Rec709 for HD outputs and SMPTE170M (BT.601) below that.
+    if (config_.mode == "live" && config_.camera.codec == "yuv420") {
+        int output_width = config_.camera.enable_scaling ? config_.camera.scaled_width
+                                                         : config_.camera.width;
+        extractor.setPixelFormat(PixelFormat::I420, output_width >= 1280);
+    } else if (config_.mode == "shm") {
+        // The ring header decides the format; same Rec709 rule as the camera
+        auto* shm_source = dynamic_cast<ShmFrameSource*>(frame_source_.get());
+        if (shm_source && shm_source->isI420()) {
+            extractor.setPixelFormat(PixelFormat::I420, shm_source->frameSize().width >= 1280);
+        }
+    }
     
     // Set LED layout for gamma calculation
-    color_extractor_->setLEDLayout(
+    extractor.setLEDLayout(
         config_.led_layout.hyperhdr_top,
         config_.led_layout.hyperhdr_bottom,
         config_.led_layout.hyperhdr_left,
@@ -357,7 +512,7 @@ bool LEDController::setupColorExtractor() {
     );
     
     // Configure 8-point gamma correction (4 corners + 4 edge centers)
-    color_extractor_->setEightPointGammaCorrection(
+    extractor.setEightPointGammaCorrection(
         config_.gamma_correction.enabled,
         config_.gamma_correction.top_left.gamma_red,
         config_.gamma_correction.top_left.gamma_green,
@@ -384,9 +539,25 @@ bool LEDController::setupColorExtractor() {
         config_.gamma_correction.left_center.gamma_green,
         config_.gamma_correction.left_center.gamma_blue
     );
+}
+
+bool LEDController::setupColorExtractor() {
+    LOG_INFO("Setting up color extractor...");
+    
+    color_extractor_ = std::make_unique<ColorExtractor>();
+    configureColorExtractor(*color_extractor_);
+    if (config_.color_extraction.engine != "mask" && config_.color_extraction.method != "mean") {
+        LOG_WARN("The " + config_.color_extraction.engine + " engine only computes means, using masks for " +
+                 config_.color_extraction.method);
+    }
     
     std::stringstream ss;
-    ss << "Color extractor ready (method: " << config_.color_extraction.method;
+    ss << "Color extractor ready (method: " << config_.color_extraction.method
+       << ", engine: " << config_.color_extraction.engine;
+    if (config_.color_extraction.max_samples_per_led > 0) {
+        ss << ", " << config_.color_extraction.sampling << " sampling, at most "
+           << config_.color_extraction.max_samples_per_led << " pixels per LED";
+    }
     if (config_.gamma_correction.enabled) {
         ss << ", 8-point gamma correction enabled - "
            << "TL(" << config_.gamma_correction.top_left.gamma_red << "," 
@@ -508,7 +679,7 @@ bool LEDController::processFrame(const cv::Mat& frame, std::vector<cv::Vec3b>& c
         if (!setupBezierCurves()) {
             return false;
         }
-        if (!setupCoonsPatching(frame.cols, frame.rows)) {
+        if (!setupCoonsPatching(frame.cols, color_extractor_->imageHeight(frame))) {
             return false;
         }
     }
@@ -524,18 +695,24 @@ bool LEDController::processSingleFrame(bool saveDebugImages) {
         LOG_ERROR("LED Controller not initialized");
         return false;
     }
+    if (!frame_source_) {
+        LOG_ERROR("No frame source in " + config_.mode + " mode");
+        return false;
+    }
     
     PerformanceTimer total_timer("Total frame processing", false);
     
     // Get frame
     cv::Mat frame;
-    if (!frame_source_->getFrame(frame)) {
+    FrameTiming timing;
+    if (!frame_source_->getFrame(frame, timing)) {
         LOG_ERROR("Failed to get frame");
         return false;
     }
+    const auto acquired = FrameTiming::Clock::now();
     
     LOG_INFO("Processing frame: " + std::to_string(frame.cols) + "x" + 
-             std::to_string(frame.rows));
+             std::to_string(color_extractor_->imageHeight(frame)));
     
     // Process frame
     std::vector<cv::Vec3b> colors;
@@ -543,6 +720,7 @@ bool LEDController::processSingleFrame(bool saveDebugImages) {
         LOG_ERROR("Failed to process frame");
         return false;
     }
+    const auto extracted = FrameTiming::Clock::now();
     
     // Log colors
     std::stringstream ss;
@@ -563,10 +741,10 @@ bool LEDController::processSingleFrame(bool saveDebugImages) {
         bool success = false;
         if (config_.hyperhdr.use_linear_format) {
             // Use linear format: 1 pixel tall, width = LED count
-            success = hyperhdr_client_->sendColorsLinear(colors);
+            success = hyperhdr_client_->sendColorsLinear(colors, timing.captured);
         } else {
             // Use layout-based 2D format
-            success = hyperhdr_client_->sendColors(colors, *led_layout_);
+            success = hyperhdr_client_->sendColors(colors, *led_layout_, timing.captured);
         }
         
         if (success) {
@@ -579,18 +757,26 @@ bool LEDController::processSingleFrame(bool saveDebugImages) {
     
     // Send to USB device
     if (usb_controller_ && usb_controller_->isConnected()) {
-        if (usb_controller_->sendColors(colors)) {
+        if (usb_controller_->sendColors(colors, timing.captured)) {
             LOG_INFO("Sent " + std::to_string(colors.size()) + " colors to USB device");
         } else {
             LOG_WARN("Failed to send colors to USB device");
         }
     }
+    recordLatency(timing, acquired, extracted, FrameTiming::Clock::now());
     
     // Save debug images
     if (saveDebugImages) {
-        saveDebugBoundaries(frame);
+        cv::Mat debug_frame = frame;
+        if (color_extractor_->getPixelFormat() == PixelFormat::I420) {
+            cv::cvtColor(frame, debug_frame, cv::COLOR_YUV2BGR_I420);
+        } else if (native_geometry_) {
+            // Debug drawing uses the logical (scaled, flipped) geometry
+            debug_frame = toLogicalFrame(frame);
+        }
+        saveDebugBoundaries(debug_frame);
         saveColorGrid(colors);
-        saveRectangleImage(frame);
+        saveRectangleImage(debug_frame);
     }
     
     total_timer.stop();
@@ -599,6 +785,54 @@ bool LEDController::processSingleFrame(bool saveDebugImages) {
     return true;
 }
 
+void LEDController::recordLatency(const FrameTiming& timing, FrameTiming::Clock::time_point acquired,
+                                  FrameTiming::Clock::time_point extracted, FrameTiming::Clock::time_point sent) {
+    auto ms = [](FrameTiming::Clock::time_point from, FrameTiming::Clock::time_point to) {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    };
+    
+    latency_.pipe.add(ms(timing.captured, timing.received));
+    latency_.decode.add(ms(timing.received, timing.decoded));
+    latency_.queue.add(ms(timing.decoded, acquired));
+    latency_.extract.add(ms(acquired, extracted));
+    latency_.send.add(ms(extracted, sent));
+    latency_.total.add(ms(timing.captured, sent));
+    latency_.sensor_timestamps = timing.sensor_timestamp;
+}
+
+void LEDController::reportLatency() {
+    if (latency_.total.count() == 0) {
+        return;
+    }
+    
+    // Sensor timestamps are anchored to the quickest frame (see FrameTiming), so
+    // pipe is jitter and every capture-based figure misses that frame's delay
+    LOG_INFO("Latency over " + std::to_string(latency_.total.count()) + " frames" +
+             (latency_.sensor_timestamps ? " (from sensor timestamps, relative to the quickest frame):"
+                                         : " (from frame arrival):"));
+    LOG_INFO(std::string(latency_.sensor_timestamps ? "  jitter   " : "  pipe     ") + latency_.pipe.summary());
+    LOG_INFO("  decode   " + latency_.decode.summary());
+    LOG_INFO("  queue    " + latency_.queue.summary());
+    LOG_INFO("  extract  " + latency_.extract.summary());
+    LOG_INFO("  send     " + latency_.send.summary());
+    LOG_INFO("  total    " + latency_.total.summary());
+    if (hyperhdr_client_ && hyperhdr_client_->latency().count() > 0) {
+        LOG_INFO("  hyperhdr " + hyperhdr_client_->latency().summary());
+        hyperhdr_client_->latency().reset();
+    }
+    if (usb_controller_ && usb_controller_->latency().count() > 0) {
+        LOG_INFO("  usb      " + usb_controller_->latency().summary());
+        usb_controller_->latency().reset();
+    }
+    
+    latency_.pipe.reset();
+    latency_.decode.reset();
+    latency_.queue.reset();
+    latency_.extract.reset();
+    latency_.send.reset();
+    latency_.total.reset();
+}
+
 int LEDController::run() {
     if (!initialized_) {
         LOG_ERROR("LED Controller not initialized");
@@ -615,7 +849,9 @@ int LEDController::run() {
     
     while (running_) {
         if (!processSingleFrame(false)) {
-            LOG_ERROR("Frame processing failed");
+            if (running_) {
+                LOG_ERROR("Frame processing failed");
+            }
             break;
         }
         
@@ -632,8 +868,23 @@ int LEDController::run() {
             auto now = std::chrono::high_resolution_clock::now();
             auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - loop_start);
             double fps = frame_count * 1000.0 / elapsed.count();
+            FrameSourceStats stats = frame_source_->getStats();
             LOG_INFO("Processed " + std::to_string(frame_count) + " frames, " +
-                    std::to_string(fps) + " FPS");
+                    std::to_string(fps) + " FPS (" +
+                    std::to_string(stats.frames_dropped) + " dropped, " +
+                    std::to_string(stats.frames_skipped) + " skipped stale, " +
+                    std::to_string(stats.buffer_allocations) + " frame buffer allocations)");
+            if (color_extractor_->isChangeDetectionEnabled()) {
+                const auto& change = color_extractor_->getChangeStats();
+                LOG_INFO("Change detection skipped " + std::to_string(change.skipped) + " of " +
+                         std::to_string(change.leds) + " LED extractions (" +
+                         std::to_string(static_cast<int>(change.skipRate() * 100.0 + 0.5)) + "% skip rate)");
+            }
+        }
+        
+        const int report_every = config_.performance.latency_report_frames;
+        if (report_every > 0 && frame_count % report_every == 0) {
+            reportLatency();
         }
     }
     
@@ -644,12 +895,311 @@ int LEDController::run() {
     LOG_INFO("Processing complete: " + std::to_string(frame_count) + 
              " frames in " + std::to_string(total_elapsed.count()) + 
              " ms (avg " + std::to_string(avg_fps) + " FPS)");
+    if (config_.performance.latency_report_frames > 0) {
+        reportLatency();
+    }
+    
+    return frame_count;
+}
+
+int LEDController::runBatch() {
+    if (!initialized_) {
+        LOG_ERROR("LED Controller not initialized");
+        return -1;
+    }
+    
+    cv::VideoCapture capture(config_.batch.input);
+    if (!capture.isOpened()) {
+        LOG_ERROR("Failed to open video: " + config_.batch.input);
+        return -1;
+    }
+    const double video_fps = capture.get(cv::CAP_PROP_FPS);
+    
+    const std::string output_path = config_.batch.output.empty() ? config_.batch.input + ".leds.csv"
+                                                                  : config_.batch.output;
+    std::ofstream output(output_path);
+    if (!output.is_open()) {
+        LOG_ERROR("Could not open timeline for writing: " + output_path);
+        return -1;
+    }
+    
+    // The first frame sets up the geometry, before any worker reads it
+    cv::Mat first;
+    if (!capture.read(first) || first.empty()) {
+        LOG_ERROR("Video has no frames: " + config_.batch.input);
+        return -1;
+    }
+    const double first_time_ms = capture.get(cv::CAP_PROP_POS_MSEC);
+    std::vector<cv::Vec3b> first_colors;
+    if (!processFrame(toLogicalFrame(first), first_colors)) {
+        LOG_ERROR("Failed to process first video frame");
+        return -1;
+    }
+    
+    // Parallel across frames instead of across LEDs within a frame. Frames
+    // finish out of order, so no colors can be carried over between them
+    color_extractor_->setParallelProcessing(false);
+    color_extractor_->setChangeDetection(false);
+    const int threads = config_.batch.threads > 0
+        ? config_.batch.threads
+        : std::max(1u, std::thread::hardware_concurrency());
+    
+    output << "frame,time_ms";
+    for (size_t i = 0; i < first_colors.size(); i++) {
+        output << ",r" << i << ",g" << i << ",b" << i;
+    }
+    output << "\n";
+    
+    struct BatchResult {
+        double time_ms;
+        std::vector<cv::Vec3b> colors;
+    };
+    struct BatchJob {
+        int index;
+        double time_ms;
+        cv::Mat frame;
+    };
+    
+    // Bounded so decoding can't run ahead of extraction by more than a few frames
+    std::deque<BatchJob> jobs;
+    const size_t max_queued = static_cast<size_t>(threads) * 2;
+    bool reading_done = false;
+    std::mutex jobs_mutex;
+    std::condition_variable job_ready, job_taken;
+    
+    // Workers finish out of order, rows are written as soon as they are contiguous
+    std::map<int, BatchResult> pending;
+    int next_to_write = 0;
+    bool failed = false;
+    std::mutex results_mutex;
+    
+    auto writeResult = [&](int index, BatchResult result) {
+        std::lock_guard<std::mutex> lock(results_mutex);
+        pending.emplace(index, std::move(result));
+        for (auto it = pending.find(next_to_write); it != pending.end(); it = pending.find(next_to_write)) {
+            output << it->first << "," << it->second.time_ms;
+            for (const auto& c : it->second.colors) {
+                output << "," << static_cast<int>(c[0]) << "," << static_cast<int>(c[1]) << ","
+                       << static_cast<int>(c[2]);
+            }
+            output << "\n";
+            pending.erase(it);
+            next_to_write++;
+        }
+    };
+    
+    auto worker = [&]() {
+        while (true) {
+            BatchJob job;
+            {
+                std::unique_lock<std::mutex> lock(jobs_mutex);
+                job_ready.wait(lock, [&] { return !jobs.empty() || reading_done; });
+                if (jobs.empty()) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job_taken.notify_one();
+            
+            BatchResult result;
+            result.time_ms = job.time_ms;
+            result.colors = color_extractor_->extractColors(toLogicalFrame(job.frame), cell_polygons_);
+            if (result.colors.empty()) {
+                std::lock_guard<std::mutex> lock(results_mutex);
+                failed = true;
+            }
+            writeResult(job.index, std::move(result));
+        }
+    };
+    
+    running_ = true;
+    LOG_INFO("Batch processing " + config_.batch.input + " with " + std::to_string(threads) +
+             " workers -> " + output_path);
+    auto batch_start = std::chrono::steady_clock::now();
+    
+    writeResult(0, BatchResult{first_time_ms, first_colors});
+    
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(worker);
+    }
+    
+    // Decoding a video is sequential, so this thread only reads and queues
+    int frame_count = 1;
+    while (running_) {
+        cv::Mat frame;  // Fresh buffer per frame, the job keeps it
+        if (!capture.read(frame) || frame.empty()) {
+            break;
+        }
+        const double time_ms = capture.get(cv::CAP_PROP_POS_MSEC);
+        
+        {
+            std::unique_lock<std::mutex> lock(jobs_mutex);
+            job_taken.wait(lock, [&] { return jobs.size() < max_queued; });
+            jobs.push_back(BatchJob{frame_count, time_ms, std::move(frame)});
+        }
+        job_ready.notify_one();
+        frame_count++;
+        
+        if (frame_count % 1000 == 0) {
+            LOG_INFO("Batch: " + std::to_string(frame_count) + " frames read");
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        reading_done = true;
+    }
+    job_ready.notify_all();
+    for (auto& t : workers) {
+        t.join();
+    }
+    output.close();
+    
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - batch_start);
+    const double seconds = std::max<int64_t>(1, elapsed.count()) / 1000.0;
+    std::string speed = std::to_string(frame_count / seconds) + " FPS";
+    if (video_fps > 0) {
+        speed += ", " + std::to_string(frame_count / video_fps / seconds) + "x real time";
+    }
+    LOG_INFO("Batch complete: " + std::to_string(frame_count) + " frames in " +
+             std::to_string(elapsed.count()) + " ms (" + speed + ")");
+    
+    if (failed) {
+        LOG_ERROR("Color extraction failed on some frames, their timeline rows are empty");
+        return -1;
+    }
+    return frame_count;
+}
+
+int LEDController::runSamplingReport(int max_frames) {
+    if (!initialized_) {
+        LOG_ERROR("LED Controller not initialized");
+        return -1;
+    }
+    if (!frame_source_) {
+        LOG_ERROR("No frame source in " + config_.mode + " mode");
+        return -1;
+    }
+    if (config_.color_extraction.max_samples_per_led <= 0) {
+        LOG_WARN("color_extraction.max_samples_per_led is 0, every pixel is read and nothing is sampled");
+    }
+    
+    // Same settings, but every covered pixel. Both extract every LED of every
+    // frame, so only the sampling error is measured
+    ColorExtractor reference;
+    configureColorExtractor(reference);
+    reference.setSampling(0, config_.color_extraction.sampling);
+    reference.setChangeDetection(false);
+    color_extractor_->setChangeDetection(false);
+    
+    LatencyHistogram sampled_ms(100.0, 0.01);
+    LatencyHistogram full_ms(100.0, 0.01);
+    std::vector<uint64_t> colors_by_error(256, 0);  // LED colors by largest channel error
+    std::vector<int> led_max_error;
+    uint64_t channel_error_sum = 0;
+    int frame_count = 0;
+    
+    running_ = true;
+    while (running_ && (max_frames <= 0 || frame_count < max_frames)) {
+        cv::Mat frame;
+        FrameTiming timing;
+        if (!frame_source_->getFrame(frame, timing)) {
+            break;
+        }
+        
+        if (frame_count == 0) {
+            // The first frame sets up the geometry, then the reference regions
+            std::vector<cv::Vec3b> colors;
+            if (!processFrame(frame, colors)) {
+                LOG_ERROR("Failed to process frame");
+                return -1;
+            }
+            reference.precomputeMasks(cell_polygons_, frame.cols, color_extractor_->imageHeight(frame));
+        }
+        
+        auto start = std::chrono::steady_clock::now();
+        std::vector<cv::Vec3b> sampled = color_extractor_->extractColors(frame, cell_polygons_);
+        auto middle = std::chrono::steady_clock::now();
+        std::vector<cv::Vec3b> full = reference.extractColors(frame, cell_polygons_);
+        auto end = std::chrono::steady_clock::now();
+        if (sampled.empty() || sampled.size() != full.size()) {
+            LOG_ERROR("Color extraction failed");
+            return -1;
+        }
+        sampled_ms.add(std::chrono::duration<double, std::milli>(middle - start).count());
+        full_ms.add(std::chrono::duration<double, std::milli>(end - middle).count());
+        
+        led_max_error.resize(full.size(), 0);
+        for (size_t led = 0; led < full.size(); led++) {
+            int error = 0;
+            for (int c = 0; c < 3; c++) {
+                const int diff = std::abs(static_cast<int>(sampled[led][c]) - static_cast<int>(full[led][c]));
+                channel_error_sum += static_cast<uint64_t>(diff);
+                error = std::max(error, diff);
+            }
+            colors_by_error[error]++;
+            led_max_error[led] = std::max(led_max_error[led], error);
+        }
+        frame_count++;
+    }
+    
+    if (frame_count == 0) {
+        LOG_ERROR("No frames to compare");
+        return -1;
+    }
+    
+    const std::vector<int>& sampled_pixels = color_extractor_->getCachedPixelCounts();
+    const std::vector<int>& full_pixels = reference.getCachedPixelCounts();
+    size_t read = 0, covered = 0, capped = 0;
+    for (size_t led = 0; led < full_pixels.size(); led++) {
+        read += static_cast<size_t>(sampled_pixels[led]);
+        covered += static_cast<size_t>(full_pixels[led]);
+        capped += sampled_pixels[led] < full_pixels[led] ? 1 : 0;
+    }
+    
+    uint64_t total = 0;
+    for (uint64_t count : colors_by_error) {
+        total += count;
+    }
+    auto share = [&](int max_error) {
+        uint64_t within = 0;
+        for (int e = 0; e <= max_error; e++) {
+            within += colors_by_error[e];
+        }
+        char text[16];
+        std::snprintf(text, sizeof(text), "%.2f%%", 100.0 * within / total);
+        return std::string(text);
+    };
+    int worst_error = 0;
+    for (int e = 0; e < 256; e++) {
+        if (colors_by_error[e] > 0) {
+            worst_error = e;
+        }
+    }
+    const size_t worst_led = static_cast<size_t>(
+        std::max_element(led_max_error.begin(), led_max_error.end()) - led_max_error.begin());
+    
+    LOG_INFO("Sampling report over " + std::to_string(frame_count) + " frames (" + config_.color_extraction.sampling +
+             ", at most " + std::to_string(config_.color_extraction.max_samples_per_led) + " pixels per LED):");
+    LOG_INFO("  pixels   " + std::to_string(read) + " of " + std::to_string(covered) + " read per frame, " +
+             std::to_string(capped) + " of " + std::to_string(full_pixels.size()) + " LEDs sampled");
+    LOG_INFO("  exact    " + share(0) + " of LED colors, within 1: " + share(1) + ", within 2: " + share(2));
+    LOG_INFO("  error    mean " + std::to_string(static_cast<double>(channel_error_sum) / (total * 3)) +
+             " per channel, worst " + std::to_string(worst_error) + " (LED " + std::to_string(worst_led) + ")");
+    LOG_INFO("  sampled  " + sampled_ms.summary());
+    LOG_INFO("  full     " + full_ms.summary());
     
     return frame_count;
 }
 
 void LEDController::stop() {
     running_ = false;
+    // A stalled camera would otherwise keep the loop waiting for its next frame
+    if (frame_source_) {
+        frame_source_->interrupt();
+    }
 }
 
 void LEDController::saveDebugBoundaries(const cv::Mat& frame) {
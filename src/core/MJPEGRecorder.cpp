@@ -0,0 +1,101 @@
+#include "core/MJPEGRecorder.h"
+#include "utils/Logger.h"
+#include <cstdio>
+
+namespace TVLED {
+
+namespace {
+    constexpr const char* TIMECODE_HEADER = "# timecode format v2";
+}
+
+MJPEGRecorder::MJPEGRecorder()
+    : open_(false), frames_written_(0), bytes_written_(0) {
+}
+
+MJPEGRecorder::~MJPEGRecorder() {
+    close();
+}
+
+bool MJPEGRecorder::open(const std::string& path) {
+    close();
+    
+    stream_.open(path, std::ios::binary | std::ios::trunc);
+    timestamps_.open(timestampPath(path), std::ios::trunc);
+    if (!stream_ || !timestamps_) {
+        LOG_ERROR("Failed to open recording: " + path);
+        stream_.close();
+        timestamps_.close();
+        return false;
+    }
+    
+    timestamps_ << TIMECODE_HEADER << "\n";
+    path_ = path;
+    open_ = true;
+    frames_written_ = 0;
+    bytes_written_ = 0;
+    
+    LOG_INFO("Recording camera stream to " + path);
+    return true;
+}
+
+void MJPEGRecorder::close() {
+    if (!open_) {
+        return;
+    }
+    
+    stream_.close();
+    timestamps_.close();
+    open_ = false;
+    
+    LOG_INFO("Recording closed: " + std::to_string(frames_written_) + " frames, " +
+             std::to_string(bytes_written_ / 1024) + " KB in " + path_);
+}
+
+bool MJPEGRecorder::write(const uint8_t* data, size_t size, Clock::time_point captured) {
+    if (!open_) {
+        return false;
+    }
+    
+    if (frames_written_ == 0) {
+        first_frame_ = captured;
+    }
+    const double ms = std::chrono::duration<double, std::milli>(captured - first_frame_).count();
+    
+    char line[32];
+    std::snprintf(line, sizeof(line), "%.3f\n", ms);
+    
+    stream_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    timestamps_ << line;
+    if (!stream_ || !timestamps_) {
+        LOG_ERROR("Failed to write recording, stopping it (disk full?)");
+        close();
+        return false;
+    }
+    
+    frames_written_++;
+    bytes_written_ += size;
+    return true;
+}
+
+bool MJPEGRecorder::readTimestamps(const std::string& path, std::vector<double>& timestamps_ms) {
+    std::ifstream file(timestampPath(path));
+    if (!file) {
+        return false;
+    }
+    
+    timestamps_ms.clear();
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        try {
+            timestamps_ms.push_back(std::stod(line));
+        } catch (...) {
+            LOG_WARN("Ignoring malformed timestamp line: " + line);
+        }
+    }
+    return !timestamps_ms.empty();
+}
+
+} // namespace TVLED
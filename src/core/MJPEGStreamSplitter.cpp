@@ -0,0 +1,107 @@
+#include "core/MJPEGStreamSplitter.h"
+#include <algorithm>
+#include <cstring>
+
+namespace TVLED {
+
+namespace {
+    constexpr uint8_t MARKER_PREFIX = 0xFF;
+    constexpr uint8_t MARKER_SOI = 0xD8;
+    constexpr uint8_t MARKER_EOI = 0xD9;
+}
+
+MJPEGStreamSplitter::MJPEGStreamSplitter(size_t initial_capacity)
+    : buffer_(std::max<size_t>(initial_capacity, 4096)),
+      read_pos_(0), write_pos_(0), scan_pos_(0), frame_start_(kNoFrame) {
+}
+
+uint8_t* MJPEGStreamSplitter::writeBuffer(size_t min_bytes) {
+    if (write_pos_ + min_bytes > buffer_.size()) {
+        // Reclaim consumed bytes by moving the unconsumed tail to the front
+        size_t shift = read_pos_;
+        if (shift > 0) {
+            std::memmove(buffer_.data(), buffer_.data() + shift, write_pos_ - shift);
+            write_pos_ -= shift;
+            scan_pos_ -= shift;
+            if (frame_start_ != kNoFrame) {
+                frame_start_ -= shift;
+            }
+            read_pos_ = 0;
+        }
+
+        // Grow only if a single frame does not fit (happens once at startup)
+        if (write_pos_ + min_bytes > buffer_.size()) {
+            buffer_.resize(std::max(buffer_.size() * 2, write_pos_ + min_bytes));
+        }
+    }
+    return buffer_.data() + write_pos_;
+}
+
+void MJPEGStreamSplitter::commit(size_t bytes) {
+    write_pos_ = std::min(write_pos_ + bytes, buffer_.size());
+}
+
+size_t MJPEGStreamSplitter::findMarker(size_t from, uint8_t marker, size_t* resume) const {
+    const uint8_t* base = buffer_.data();
+
+    while (from < write_pos_) {
+        const void* hit = std::memchr(base + from, MARKER_PREFIX, write_pos_ - from);
+        if (!hit) {
+            break;
+        }
+
+        size_t offset = static_cast<const uint8_t*>(hit) - base;
+        if (offset + 1 >= write_pos_) {
+            // 0xFF is the last buffered byte, re-check it once more data arrives
+            *resume = offset;
+            return kNoFrame;
+        }
+        if (base[offset + 1] == marker) {
+            return offset;
+        }
+        from = offset + 1;
+    }
+
+    *resume = write_pos_;
+    return kNoFrame;
+}
+
+bool MJPEGStreamSplitter::nextFrame(const uint8_t*& data, size_t& size) {
+    size_t resume = 0;
+
+    if (frame_start_ == kNoFrame) {
+        size_t soi = findMarker(scan_pos_, MARKER_SOI, &resume);
+        if (soi == kNoFrame) {
+            // Nothing before 'resume' can start a frame, drop it
+            scan_pos_ = resume;
+            read_pos_ = resume;
+            return false;
+        }
+        frame_start_ = soi;
+        read_pos_ = soi;
+        scan_pos_ = soi + 2;
+    }
+
+    size_t eoi = findMarker(scan_pos_, MARKER_EOI, &resume);
+    if (eoi == kNoFrame) {
+        scan_pos_ = resume;
+        return false;
+    }
+
+    data = buffer_.data() + frame_start_;
+    size = eoi + 2 - frame_start_;
+
+    read_pos_ = eoi + 2;
+    scan_pos_ = eoi + 2;
+    frame_start_ = kNoFrame;
+    return true;
+}
+
+void MJPEGStreamSplitter::reset() {
+    read_pos_ = 0;
+    write_pos_ = 0;
+    scan_pos_ = 0;
+    frame_start_ = kNoFrame;
+}
+
+} // namespace TVLED
@@ -0,0 +1,159 @@
+#include "core/ReplayFrameSource.h"
+#include "core/MJPEGRecorder.h"
+#include "utils/Logger.h"
+#include <algorithm>
+#include <thread>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace TVLED {
+
+ReplayFrameSource::ReplayFrameSource(const std::string& path, bool realtime, bool loop,
+                                     int width, int height, int fps,
+                                     bool enable_scaling, int scaled_width, int scaled_height,
+                                     bool flip_horizontal, bool flip_vertical,
+                                     bool dct_scaling, bool fast_decode,
+                                     bool native_output)
+    : CameraFrameSource(path, width, height, fps, -1, "default", 0.0f, "auto", 0.0f, 0.0f,
+                        0.0f, 0.0f, 0.0f, 0, {},
+                        enable_scaling, scaled_width, scaled_height,
+                        flip_horizontal, flip_vertical,
+                        "mjpeg", 0, dct_scaling, fast_decode, native_output),
+      path_(path), realtime_(realtime), loop_(loop), fps_(fps > 0 ? fps : 30),
+      frame_index_(0), pass_first_sequence_(0), frames_played_(0), loops_(0), rewound_(false) {
+}
+
+bool ReplayFrameSource::initialize() {
+    if (MJPEGRecorder::readTimestamps(path_, timestamps_ms_)) {
+        LOG_INFO("Loaded " + std::to_string(timestamps_ms_.size()) + " frame timestamps from " +
+                 MJPEGRecorder::timestampPath(path_));
+    } else if (realtime_) {
+        LOG_WARN("No timestamps for " + path_ + ", pacing at " + std::to_string(fps_) + " fps");
+    }
+    
+    if (!CameraFrameSource::initialize()) {
+        return false;
+    }
+    
+    frame_index_ = 0;
+    pass_first_sequence_ = nextSequence();
+    frames_played_ = 0;
+    loops_ = 0;
+    rewound_ = false;
+    playback_start_ = Clock::now();
+    return true;
+}
+
+int ReplayFrameSource::openStream() {
+    int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open recording " + path_ + ": " + std::string(strerror(errno)));
+    }
+    return fd;
+}
+
+bool ReplayFrameSource::onEndOfStream(int fd) {
+    if (!loop_) {
+        LOG_INFO("Replay finished after " + std::to_string(frames_played_) + " frames");
+        return false;
+    }
+    
+    if (frame_index_ == 0 || lseek(fd, 0, SEEK_SET) != 0) {
+        LOG_ERROR("Cannot loop recording " + path_ + " (empty or not seekable)");
+        return false;
+    }
+    
+    rewound_ = true;
+    pass_first_sequence_ = nextSequence();
+    return true;
+}
+
+double ReplayFrameSource::frameTimeMs(size_t index) const {
+    if (index < timestamps_ms_.size()) {
+        return timestamps_ms_[index] - timestamps_ms_.front();
+    }
+    
+    // Past the recorded timestamps (or none): continue at the nominal rate
+    const double base = timestamps_ms_.empty() ? 0.0 : timestamps_ms_.back() - timestamps_ms_.front();
+    const size_t base_index = timestamps_ms_.empty() ? 0 : timestamps_ms_.size() - 1;
+    return base + static_cast<double>(index - base_index) * 1000.0 / fps_;
+}
+
+ReplayFrameSource::Clock::time_point ReplayFrameSource::dueTime(size_t index) const {
+    return playback_start_ + std::chrono::duration_cast<Clock::duration>(
+               std::chrono::duration<double, std::milli>(frameTimeMs(index)));
+}
+
+bool ReplayFrameSource::waitUntil(Clock::time_point due) const {
+    while (!interrupted()) {
+        const Clock::time_point now = Clock::now();
+        if (now >= due) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::min<Clock::duration>(INTERRUPT_SLICE, due - now));
+    }
+    return false;
+}
+
+bool ReplayFrameSource::getFrame(cv::Mat& frame, FrameTiming& timing) {
+    if (!isReady()) {
+        LOG_ERROR("ReplayFrameSource not initialized");
+        return false;
+    }
+    
+    // Wait for the next frame's capture time first, then read and decode it
+    // like a camera frame arriving at that moment
+    Clock::time_point due = Clock::now();
+    if (realtime_) {
+        due = dueTime(frame_index_);
+        if (!waitUntil(due)) {
+            LOG_INFO("Replay interrupted");
+            return false;
+        }
+    }
+    
+    if (!readFrame(frame, timing)) {
+        return false;
+    }
+    
+    if (rewound_) {
+        // This was from the next pass, which starts one frame after the last
+        rewound_ = false;
+        loops_++;
+        playback_start_ = due;
+    }
+    
+    // Frames that failed to decode were skipped, so the one returned may sit
+    // further along the stream: pace it by its own timestamp, as if it arrived
+    // then (its read and decode times move along with it)
+    const size_t index = static_cast<size_t>(timing.sequence - pass_first_sequence_);
+    if (realtime_) {
+        const Clock::time_point frame_due = dueTime(index);
+        if (frame_due > due) {
+            if (!waitUntil(frame_due)) {
+                LOG_INFO("Replay interrupted");
+                return false;
+            }
+            timing.received += frame_due - due;
+            timing.decoded += frame_due - due;
+            due = frame_due;
+        }
+        timing.captured = due;
+    }
+    
+    frame_index_ = index + 1;
+    frames_played_++;
+    return true;
+}
+
+std::string ReplayFrameSource::getName() const {
+    std::string name = "ReplayFrameSource: " + path_ + (realtime_ ? " [real-time]" : " [as fast as possible]");
+    if (loop_) {
+        name += " [loop]";
+    }
+    return name;
+}
+
+} // namespace TVLED
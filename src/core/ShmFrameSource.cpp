@@ -0,0 +1,234 @@
+#include "core/ShmFrameSource.h"
+#include "utils/Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace TVLED {
+
+namespace {
+    // Longest single futex wait, bounds how late interrupt() is noticed
+    constexpr int WAIT_SLICE_MS = 100;
+}
+
+ShmFrameSource::ShmFrameSource(const std::string& name, int timeout_ms)
+    : name_(name), timeout_ms_(timeout_ms), interrupted_(false), mapping_(nullptr), mapping_size_(0), header_(nullptr),
+      last_frame_(0), overruns_(0), frames_captured_(0), frames_dropped_(0) {
+}
+
+ShmFrameSource::~ShmFrameSource() {
+    release();
+}
+
+bool ShmFrameSource::initialize() {
+    LOG_INFO("Initializing ShmFrameSource: " + name_);
+    interrupted_ = false;
+
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open shared memory " + name_ + ": " + std::strerror(errno) +
+                  " (is the capture process running?)");
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(ShmFrameRing::Header))) {
+        LOG_ERROR("Shared memory " + name_ + " is too small for a frame ring header");
+        close(fd);
+        return false;
+    }
+
+    // Read-only: frames are consumed in place and never written by this process
+    mapping_size_ = static_cast<size_t>(st.st_size);
+    mapping_ = mmap(nullptr, mapping_size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping_ == MAP_FAILED) {
+        LOG_ERROR("Failed to map shared memory " + name_ + ": " + std::strerror(errno));
+        mapping_ = nullptr;
+        return false;
+    }
+    header_ = static_cast<ShmFrameRing::Header*>(mapping_);
+
+    const ShmFrameRing::Header& h = *header_;
+    std::string problem;
+    if (h.magic != ShmFrameRing::MAGIC) {
+        problem = "not a frame ring (bad magic)";
+    } else if (h.version != ShmFrameRing::VERSION) {
+        problem = "unsupported ring version " + std::to_string(h.version);
+    } else if (h.width == 0 || h.height == 0 || h.slot_count < 2) {
+        problem = "invalid geometry";
+    } else if (h.format == ShmFrameRing::FORMAT_BGR) {
+        if (h.stride < h.width * 3) problem = "BGR stride smaller than a row";
+    } else if (h.format == ShmFrameRing::FORMAT_I420) {
+        if (h.stride != h.width || h.width % 2 || h.height % 2) problem = "I420 frames must be packed with even size";
+    } else {
+        problem = "unknown pixel format " + std::to_string(h.format);
+    }
+    if (problem.empty() &&
+        (h.slot_size < h.data_offset + ShmFrameRing::frameBytes(h.height, h.format, h.stride) ||
+         ShmFrameRing::mappingSize(h) > mapping_size_)) {
+        problem = "slots do not fit the shared memory object";
+    }
+    if (!problem.empty()) {
+        LOG_ERROR("Shared memory " + name_ + ": " + problem);
+        release();
+        return false;
+    }
+
+    // Start from whatever is published now, earlier frames don't count as dropped
+    last_frame_ = 0;
+    overruns_ = 0;
+    frames_captured_ = 0;
+    frames_dropped_ = 0;
+
+    if (!writerAlive()) {
+        LOG_WARN("Frame ring writer is not running (stale shared memory?)");
+    }
+
+    LOG_INFO("Shared memory frame source ready: " + getName());
+    return true;
+}
+
+bool ShmFrameSource::writerAlive() const {
+    const int pid = header_->writer_pid.load(std::memory_order_relaxed);
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+void ShmFrameSource::checkOverrun() {
+    if (last_frame_ == 0) {
+        return;
+    }
+
+    // Did the writer reuse the slot while the previous frame was being processed?
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const ShmFrameRing::SlotHeader* s = ShmFrameRing::slot(mapping_, *header_, last_frame_);
+    if (s->sequence.load(std::memory_order_relaxed) != last_frame_) {
+        overruns_++;
+        if (overruns_ == 1 || overruns_ % 100 == 0) {
+            LOG_WARN("Frame ring writer overwrote a frame still in use (" + std::to_string(overruns_) +
+                     " times), ring has too few slots for the processing time");
+        }
+    }
+}
+
+bool ShmFrameSource::getFrame(cv::Mat& frame, FrameTiming& timing) {
+    if (!header_) {
+        LOG_ERROR("ShmFrameSource not initialized");
+        return false;
+    }
+
+    checkOverrun();
+
+    auto wait_start = FrameTiming::Clock::now();
+    while (true) {
+        if (interrupted_) {
+            LOG_INFO("Frame ring wait interrupted");
+            return false;
+        }
+
+        // Futex word first: a publish after this load makes the wait return at once
+        const uint32_t seen = header_->futex.load(std::memory_order_acquire);
+        const uint64_t published = header_->published.load(std::memory_order_acquire);
+
+        if (published > last_frame_) {
+            ShmFrameRing::SlotHeader* s = ShmFrameRing::slot(mapping_, *header_, published);
+            if (s->sequence.load(std::memory_order_acquire) != published) {
+                continue;  // Lapped between the two loads, take the newer frame
+            }
+
+            timing.received = FrameTiming::Clock::now();
+            if (last_frame_ > 0) {
+                frames_dropped_ += published - last_frame_ - 1;
+            }
+            last_frame_ = published;
+            frames_captured_++;
+
+            uint8_t* data = ShmFrameRing::slotData(s, *header_);
+            const int width = static_cast<int>(header_->width);
+            const int height = static_cast<int>(header_->height);
+            if (header_->format == ShmFrameRing::FORMAT_I420) {
+                frame = cv::Mat(height * 3 / 2, width, CV_8UC1, data);
+            } else {
+                frame = cv::Mat(height, width, CV_8UC3, data, header_->stride);
+            }
+
+            // steady_clock is CLOCK_MONOTONIC, the clock writers stamp frames with
+            const uint64_t ts = s->timestamp_ns;
+            timing.sensor_timestamp = ts != 0;
+            timing.captured = ts != 0 ? FrameTiming::Clock::time_point(std::chrono::nanoseconds(ts))
+                                      : timing.received;
+            timing.decoded = timing.received;
+            timing.sequence = published;
+            return true;
+        }
+
+        if (FrameTiming::Clock::now() - wait_start >= std::chrono::milliseconds(timeout_ms_)) {
+            if (!writerAlive()) {
+                LOG_ERROR("Frame ring writer has stopped (" + name_ + ")");
+                return false;
+            }
+            LOG_WARN("No frame from the frame ring writer in " + std::to_string(timeout_ms_) + " ms");
+            wait_start = FrameTiming::Clock::now();
+        }
+        ShmFrameRing::waitForFrame(*header_, seen, std::min(timeout_ms_, WAIT_SLICE_MS));
+    }
+}
+
+void ShmFrameSource::interrupt() {
+    interrupted_ = true;
+}
+
+void ShmFrameSource::release() {
+    if (!mapping_) {
+        return;
+    }
+
+    if (frames_captured_ > 0) {
+        LOG_INFO("ShmFrameSource released: " + std::to_string(frames_captured_.load()) + " frames, " +
+                 std::to_string(frames_dropped_.load()) + " dropped, " +
+                 std::to_string(overruns_) + " overwritten while in use");
+    }
+    munmap(mapping_, mapping_size_);
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+    header_ = nullptr;
+}
+
+std::string ShmFrameSource::getName() const {
+    if (!header_) {
+        return "ShmFrameSource: " + name_;
+    }
+    return "ShmFrameSource: " + name_ + " " + std::to_string(header_->width) + "x" +
+           std::to_string(header_->height) + (isI420() ? " i420" : " bgr") + ", " +
+           std::to_string(header_->slot_count) + " slots";
+}
+
+bool ShmFrameSource::isReady() const {
+    return header_ != nullptr;
+}
+
+bool ShmFrameSource::isI420() const {
+    return header_ && header_->format == ShmFrameRing::FORMAT_I420;
+}
+
+cv::Size ShmFrameSource::frameSize() const {
+    if (!header_) {
+        return cv::Size();
+    }
+    return cv::Size(static_cast<int>(header_->width), static_cast<int>(header_->height));
+}
+
+FrameSourceStats ShmFrameSource::getStats() const {
+    FrameSourceStats stats;
+    stats.frames_captured = frames_captured_.load();
+    stats.frames_dropped = frames_dropped_.load();
+    return stats;
+}
+
+} // namespace TVLED
@@ -0,0 +1,190 @@
+#include "core/SyntheticFrameSource.h"
+#include "utils/Logger.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace TVLED {
+
+namespace {
+    constexpr uint64_t NOISE_SEED = 0x5EED;
+    
+    // Letterboxed content aspect ratio (cinemascope)
+    constexpr double LETTERBOX_ASPECT = 2.39;
+    
+    // Classic 75% color bars (BGR)
+    const cv::Vec3b BAR_COLORS[] = {
+        {191, 191, 191}, {0, 191, 191}, {191, 191, 0}, {0, 191, 0},
+        {191, 0, 191}, {0, 0, 191}, {191, 0, 0}, {0, 0, 0}
+    };
+    constexpr int NUM_BARS = sizeof(BAR_COLORS) / sizeof(BAR_COLORS[0]);
+}
+
+SyntheticFrameSource::SyntheticFrameSource(const std::string& pattern, int width, int height, int fps)
+    : pattern_name_(pattern), pattern_(Pattern::Gradient), width_(width), height_(height), fps_(fps),
+      initialized_(false), rng_(NOISE_SEED), frame_index_(0) {
+}
+
+bool SyntheticFrameSource::isValidPattern(const std::string& pattern) {
+    return pattern == "gradient" || pattern == "bars" || pattern == "noise" ||
+           pattern == "letterbox" || pattern == "static";
+}
+
+bool SyntheticFrameSource::initialize() {
+    if (!isValidPattern(pattern_name_)) {
+        LOG_ERROR("Unknown synthetic pattern: " + pattern_name_);
+        return false;
+    }
+    if (width_ <= 0 || height_ <= 0) {
+        LOG_ERROR("Invalid synthetic frame size: " + std::to_string(width_) + "x" + std::to_string(height_));
+        return false;
+    }
+    
+    if (pattern_name_ == "gradient") pattern_ = Pattern::Gradient;
+    else if (pattern_name_ == "bars") pattern_ = Pattern::Bars;
+    else if (pattern_name_ == "noise") pattern_ = Pattern::Noise;
+    else if (pattern_name_ == "letterbox") pattern_ = Pattern::Letterbox;
+    else pattern_ = Pattern::Static;
+    
+    row_.resize(width_);
+    frame_pool_.clear();
+    rng_ = cv::RNG(NOISE_SEED);
+    frame_index_ = 0;
+    
+    if (pattern_ == Pattern::Static) {
+        static_frame_.create(height_, width_, CV_8UC3);
+        renderGradient(static_frame_, 0);
+    }
+    
+    next_frame_time_ = Clock::now();
+    initialized_ = true;
+    
+    LOG_INFO("Synthetic frame source ready: " + getName());
+    return true;
+}
+
+void SyntheticFrameSource::renderGradient(cv::Mat& frame, int offset) {
+    // Blue/red run along x (scrolling), green along y
+    for (int x = 0; x < width_; x++) {
+        const int t = ((x + offset) % width_) * 256 / width_;
+        row_[x] = cv::Vec3b(static_cast<uchar>(t), 0, static_cast<uchar>(255 - t));
+    }
+    
+    for (int y = 0; y < height_; y++) {
+        const uchar green = static_cast<uchar>(y * 256 / height_);
+        cv::Vec3b* dst = frame.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < width_; x++) {
+            dst[x] = cv::Vec3b(row_[x][0], green, row_[x][2]);
+        }
+    }
+}
+
+void SyntheticFrameSource::renderBars(cv::Mat& frame, int offset) {
+    for (int x = 0; x < width_; x++) {
+        const int bar = ((x + offset) % width_) * NUM_BARS / width_;
+        row_[x] = BAR_COLORS[bar];
+    }
+    
+    const size_t row_bytes = static_cast<size_t>(width_) * sizeof(cv::Vec3b);
+    for (int y = 0; y < height_; y++) {
+        std::memcpy(frame.ptr(y), row_.data(), row_bytes);
+    }
+}
+
+void SyntheticFrameSource::renderLetterbox(cv::Mat& frame, int offset) {
+    renderGradient(frame, offset);
+    
+    const int content_height = std::min(height_, static_cast<int>(width_ / LETTERBOX_ASPECT + 0.5));
+    const int bar_height = (height_ - content_height) / 2;
+    if (bar_height > 0) {
+        frame.rowRange(0, bar_height).setTo(cv::Scalar::all(0));
+        frame.rowRange(height_ - bar_height, height_).setTo(cv::Scalar::all(0));
+    }
+}
+
+bool SyntheticFrameSource::getFrame(cv::Mat& frame, FrameTiming& timing) {
+    if (!initialized_) {
+        LOG_ERROR("SyntheticFrameSource not initialized");
+        return false;
+    }
+    
+    if (fps_ > 0) {
+        next_frame_time_ += std::chrono::microseconds(1000000 / fps_);
+        auto now = Clock::now();
+        if (next_frame_time_ < now) {
+            // Fell behind (slow consumer), don't try to catch up with a burst
+            next_frame_time_ = now;
+        } else {
+            std::this_thread::sleep_until(next_frame_time_);
+        }
+    }
+    
+    // "Captured" now, rendering stands in for decoding
+    timing.captured = timing.received = FrameTiming::Clock::now();
+    timing.sequence = frame_index_.load();
+    timing.sensor_timestamp = false;
+    
+    // Move roughly one screen width every 4 seconds at 60 fps
+    const int offset = static_cast<int>((frame_index_.load() * std::max(1, width_ / 240)) % width_);
+    frame_index_++;
+    
+    if (pattern_ == Pattern::Static) {
+        frame = static_frame_;  // Read-only downstream, no copy needed
+        timing.decoded = timing.received;
+        return true;
+    }
+    
+    // Drop the caller's previous frame first so its buffer can be reused
+    frame.release();
+    cv::Mat buffer = frame_pool_.acquire(cv::Size(width_, height_), CV_8UC3);
+    switch (pattern_) {
+        case Pattern::Gradient:
+            renderGradient(buffer, offset);
+            break;
+        case Pattern::Bars:
+            renderBars(buffer, offset);
+            break;
+        case Pattern::Noise:
+            rng_.fill(buffer, cv::RNG::UNIFORM, 0, 256);
+            break;
+        case Pattern::Letterbox:
+            renderLetterbox(buffer, offset);
+            break;
+        case Pattern::Static:
+            break;
+    }
+    
+    frame = buffer;
+    timing.decoded = FrameTiming::Clock::now();
+    return true;
+}
+
+void SyntheticFrameSource::release() {
+    if (!initialized_) {
+        return;
+    }
+    
+    LOG_INFO("SyntheticFrameSource released: " + std::to_string(frame_index_.load()) + " frames generated, " +
+             std::to_string(frame_pool_.allocations()) + " buffers allocated");
+    frame_pool_.clear();
+    static_frame_.release();
+    initialized_ = false;
+}
+
+std::string SyntheticFrameSource::getName() const {
+    return "SyntheticFrameSource: " + pattern_name_ + " " + std::to_string(width_) + "x" +
+           std::to_string(height_) + (fps_ > 0 ? "@" + std::to_string(fps_) + "fps" : " (unpaced)");
+}
+
+FrameSourceStats SyntheticFrameSource::getStats() const {
+    FrameSourceStats stats;
+    stats.frames_captured = frame_index_.load();
+    stats.buffer_allocations = frame_pool_.allocations();
+    return stats;
+}
+
+bool SyntheticFrameSource::isReady() const {
+    return initialized_;
+}
+
+} // namespace TVLED
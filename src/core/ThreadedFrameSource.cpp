@@ -0,0 +1,145 @@
+#include "core/ThreadedFrameSource.h"
+#include "utils/Logger.h"
+#include <chrono>
+
+namespace TVLED {
+
+namespace {
+    // How long getFrame() waits for the capture thread before warning. The wrapped
+    // source may be restarting its camera, so only a failed capture thread or
+    // interrupt() ends the wait; the flag is checked every slice.
+    constexpr auto FRAME_WAIT_TIMEOUT = std::chrono::milliseconds(2000);
+    constexpr auto FRAME_WAIT_SLICE = std::chrono::milliseconds(50);
+}
+
+ThreadedFrameSource::ThreadedFrameSource(std::unique_ptr<FrameSource> source)
+    : source_(std::move(source)), running_(false), failed_(false), interrupted_(false),
+      frames_captured_(0), frames_dropped_(0) {
+}
+
+ThreadedFrameSource::~ThreadedFrameSource() {
+    release();
+}
+
+bool ThreadedFrameSource::initialize() {
+    if (!source_ || !source_->initialize()) {
+        LOG_ERROR("Failed to initialize wrapped frame source");
+        return false;
+    }
+
+    failed_ = false;
+    interrupted_ = false;
+    running_ = true;
+    capture_thread_ = std::thread(&ThreadedFrameSource::captureLoop, this);
+
+    LOG_INFO("Capture thread started");
+    return true;
+}
+
+void ThreadedFrameSource::captureLoop() {
+    while (running_) {
+        TimedFrame& slot = buffer_.writeSlot();
+        if (!source_->getFrame(slot.frame, slot.timing)) {
+            LOG_ERROR("Capture thread failed to get frame, stopping");
+            failed_ = true;
+            break;
+        }
+
+        frames_captured_++;
+        if (buffer_.publish()) {
+            // Previous frame was never consumed, processing is slower than the camera
+            frames_dropped_++;
+        }
+
+        {
+            // Empty critical section orders the publish with the consumer's wait
+            std::lock_guard<std::mutex> lock(wait_mutex_);
+        }
+        frame_ready_.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(wait_mutex_);
+    }
+    frame_ready_.notify_all();
+}
+
+bool ThreadedFrameSource::getFrame(cv::Mat& frame, FrameTiming& timing) {
+    if (!running_ && !buffer_.hasNew()) {
+        LOG_ERROR("ThreadedFrameSource not running");
+        return false;
+    }
+
+    {
+        // interrupt() cannot notify from a signal handler, so wake up in slices
+        std::unique_lock<std::mutex> lock(wait_mutex_);
+        auto waited = std::chrono::milliseconds(0);
+        while (!frame_ready_.wait_for(lock, FRAME_WAIT_SLICE, [this] {
+            return buffer_.hasNew() || failed_ || !running_ || interrupted_;
+        })) {
+            waited += FRAME_WAIT_SLICE;
+            if (waited % FRAME_WAIT_TIMEOUT == std::chrono::milliseconds(0)) {
+                LOG_WARN("Still waiting for capture thread");
+            }
+        }
+    }
+
+    if (interrupted_) {
+        LOG_INFO("Frame wait interrupted");
+        return false;
+    }
+    if (!buffer_.consume()) {
+        LOG_ERROR("Capture thread stopped");
+        return false;
+    }
+
+    frame = buffer_.readSlot().frame;
+    timing = buffer_.readSlot().timing;
+    return true;
+}
+
+void ThreadedFrameSource::stopCaptureThread() {
+    running_ = false;
+    if (capture_thread_.joinable()) {
+        capture_thread_.join();
+    }
+}
+
+void ThreadedFrameSource::release() {
+    if (!capture_thread_.joinable()) {
+        return;
+    }
+
+    stopCaptureThread();
+    source_->release();
+
+    LOG_INFO("Capture thread stopped: " + std::to_string(frames_captured_.load()) +
+             " frames captured, " + std::to_string(frames_dropped_.load()) + " stale frames dropped");
+}
+
+std::string ThreadedFrameSource::getName() const {
+    return source_->getName() + " [capture thread]";
+}
+
+bool ThreadedFrameSource::isReady() const {
+    return running_ && !failed_ && source_->isReady();
+}
+
+FrameSourceStats ThreadedFrameSource::getStats() const {
+    FrameSourceStats stats = source_->getStats();
+    stats.frames_captured = frames_captured_.load();
+    stats.frames_dropped = frames_dropped_.load();
+    return stats;
+}
+
+void ThreadedFrameSource::interrupt() {
+    interrupted_ = true;
+    source_->interrupt();
+}
+
+void ThreadedFrameSource::setRegionsOfInterest(const std::vector<cv::Rect>& regions) {
+    // Wrapped sources pick the regions up on their next frame
+    source_->setRegionsOfInterest(regions);
+}
+
+} // namespace TVLED
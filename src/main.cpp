@@ -4,6 +4,8 @@
 #include <iostream>
 #include <csignal>
 #include <atomic>
+#include <cstdio>
+#include <cstdlib>
 
 using namespace TVLED;
 
@@ -28,6 +30,17 @@ void printUsage(const char* program_name) {
               << "  --live               Run in live mode (camera)\n"
               << "  --image <path>       Input image for debug mode\n"
               << "  --camera <device>    Camera device (default: /dev/video0)\n"
+              << "  --record <path>      Record the camera stream (+ <path>.pts) in live mode\n"
+              << "  --replay <path>      Run in replay mode on a recording\n"
+              << "  --replay-fast        Replay as fast as possible instead of in real time\n"
+              << "  --replay-loop        Restart the replay at the end of the recording\n"
+              << "  --synthetic <pattern> Run on generated frames (gradient, bars, noise, letterbox, static)\n"
+              << "  --synthetic-size <WxH> Synthetic frame size (default from config)\n"
+              << "  --shm <name>         Run on raw frames from a shared-memory frame ring\n"
+              << "  --batch <video>      Write the LED color timeline of a video file (all cores)\n"
+              << "  --batch-output <path> Timeline CSV (default: <video>.leds.csv)\n"
+              << "  --batch-threads <n>  Worker threads for batch mode (default: all cores)\n"
+              << "  --sampling-report <n> Compare sampled and full-region colors over n frames (0 = all)\n"
               << "  --single-frame       Process single frame and exit\n"
               << "  --save-debug         Save debug images\n"
               << "  --verbose            Enable verbose logging\n"
@@ -35,6 +48,12 @@ void printUsage(const char* program_name) {
               << "Examples:\n"
               << "  " << program_name << " --debug --image test.png --single-frame --save-debug\n"
               << "  " << program_name << " --live --camera /dev/video0\n"
+              << "  " << program_name << " --live --record capture.mjpeg\n"
+              << "  " << program_name << " --replay capture.mjpeg --replay-fast\n"
+              << "  " << program_name << " --synthetic noise --synthetic-size 3840x2160\n"
+              << "  " << program_name << " --shm /tvled-frames\n"
+              << "  " << program_name << " --batch reference.mp4 --batch-output reference.csv\n"
+              << "  " << program_name << " --replay capture.mjpeg --replay-fast --sampling-report 0\n"
               << "  " << program_name << " --config my_config.json\n";
 }
 
@@ -44,6 +63,18 @@ int main(int argc, char* argv[]) {
     std::string mode;
     std::string image_path;
     std::string camera_device;
+    std::string record_path;
+    std::string replay_path;
+    bool replay_fast = false;
+    bool replay_loop = false;
+    std::string synthetic_pattern;
+    int synthetic_width = 0;
+    int synthetic_height = 0;
+    std::string shm_name;
+    std::string batch_input;
+    std::string batch_output;
+    int batch_threads = -1;
+    int sampling_report_frames = -1;
     bool single_frame = false;
     bool save_debug = false;
     bool verbose = false;
@@ -64,6 +95,36 @@ int main(int argc, char* argv[]) {
             image_path = argv[++i];
         } else if (arg == "--camera" && i + 1 < argc) {
             camera_device = argv[++i];
+        } else if (arg == "--record" && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            mode = "replay";
+            replay_path = argv[++i];
+        } else if (arg == "--replay-fast") {
+            replay_fast = true;
+        } else if (arg == "--replay-loop") {
+            replay_loop = true;
+        } else if (arg == "--synthetic" && i + 1 < argc) {
+            mode = "synthetic";
+            synthetic_pattern = argv[++i];
+        } else if (arg == "--shm" && i + 1 < argc) {
+            mode = "shm";
+            shm_name = argv[++i];
+        } else if (arg == "--batch" && i + 1 < argc) {
+            mode = "batch";
+            batch_input = argv[++i];
+        } else if (arg == "--batch-output" && i + 1 < argc) {
+            batch_output = argv[++i];
+        } else if (arg == "--batch-threads" && i + 1 < argc) {
+            batch_threads = std::atoi(argv[++i]);
+        } else if (arg == "--synthetic-size" && i + 1 < argc) {
+            std::string size = argv[++i];
+            if (std::sscanf(size.c_str(), "%dx%d", &synthetic_width, &synthetic_height) != 2) {
+                std::cerr << "Invalid size: " << size << " (expected WxH)\n";
+                return 1;
+            }
+        } else if (arg == "--sampling-report" && i + 1 < argc) {
+            sampling_report_frames = std::atoi(argv[++i]);
         } else if (arg == "--single-frame") {
             single_frame = true;
         } else if (arg == "--save-debug") {
@@ -104,6 +165,39 @@ int main(int argc, char* argv[]) {
         config.camera.device = camera_device;
         LOG_INFO("Camera device overridden to: " + camera_device);
     }
+    if (!record_path.empty()) {
+        config.camera.record_path = record_path;
+        LOG_INFO("Recording camera stream to: " + record_path);
+    }
+    if (!replay_path.empty()) {
+        config.replay.path = replay_path;
+        LOG_INFO("Replay recording overridden to: " + replay_path);
+    }
+    if (replay_fast) {
+        config.replay.realtime = false;
+    }
+    if (replay_loop) {
+        config.replay.loop = true;
+    }
+    if (!synthetic_pattern.empty()) {
+        config.synthetic.pattern = synthetic_pattern;
+    }
+    if (synthetic_width > 0 && synthetic_height > 0) {
+        config.synthetic.width = synthetic_width;
+        config.synthetic.height = synthetic_height;
+    }
+    if (!shm_name.empty()) {
+        config.shm.name = shm_name;
+    }
+    if (!batch_input.empty()) {
+        config.batch.input = batch_input;
+    }
+    if (!batch_output.empty()) {
+        config.batch.output = batch_output;
+    }
+    if (batch_threads >= 0) {
+        config.batch.threads = batch_threads;
+    }
     
     // Create controller
     ::TVLED::LEDController controller(config);
@@ -121,7 +215,13 @@ int main(int argc, char* argv[]) {
     
     // Run
     int result = 0;
-    if (single_frame) {
+    if (config.mode == "batch") {
+        int frames = controller.runBatch();
+        result = frames > 0 ? 0 : 1;
+    } else if (sampling_report_frames >= 0) {
+        int frames = controller.runSamplingReport(sampling_report_frames);
+        result = frames > 0 ? 0 : 1;
+    } else if (single_frame) {
         LOG_INFO("Processing single frame...");
         if (controller.processSingleFrame(save_debug)) {
             LOG_INFO("Single frame processed successfully");
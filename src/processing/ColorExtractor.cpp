@@ -1,165 +1,484 @@
 #include "processing/ColorExtractor.h"
+#include "processing/SpanKernels.h"
 #include "utils/Logger.h"
 #include "utils/PerformanceTimer.h"
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <unistd.h>
 
-#ifdef _OPENMP
-#include <omp.h>
-#endif
+namespace TVLED {
 
-// NEON SIMD support for ARM processors
-#if defined(__ARM_NEON) || defined(__ARM_NEON__)
-#include <arm_neon.h>
-#define USE_NEON_SIMD 1
+namespace {
+    // Chunks per pool worker: enough slack for stealing to even out the rest
+    constexpr size_t CHUNKS_PER_WORKER = 4;
+    
+    // Cut items into chunks of about equal cost. cumulative[i] is the cost of
+    // items [0, i), so it has one entry more than there are items.
+    std::vector<size_t> balancedChunks(const std::vector<size_t>& cumulative, size_t chunks) {
+        const size_t items = cumulative.empty() ? 0 : cumulative.size() - 1;
+        const size_t total = items > 0 ? cumulative.back() : 0;
+        chunks = std::max<size_t>(1, std::min(chunks, items));
+        
+        std::vector<size_t> begin{0};
+        for (size_t c = 1; c < chunks; c++) {
+            const size_t target = total * c / chunks;
+            size_t cut = static_cast<size_t>(std::lower_bound(cumulative.begin(), cumulative.end() - 1, target) -
+                                             cumulative.begin());
+            cut = std::max(cut, begin.back());
+            if (cut > begin.back() && cut < items) {
+                begin.push_back(cut);
+            }
+        }
+        begin.push_back(items);
+        return begin;
+    }
+    
+    // L2 size as reported by the C library; some ARM systems report nothing,
+    // then assume the 512 KiB per core of a Cortex-A76
+    size_t l2CacheBytes() {
+#ifdef _SC_LEVEL2_CACHE_SIZE
+        const long bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        if (bytes > 0) {
+            return static_cast<size_t>(bytes);
+        }
 #endif
+        return 512 * 1024;
+    }
+}
 
-namespace TVLED {
+namespace {
+    // Copies of the histogram filled round-robin, so consecutive pixels of
+    // the same color update different memory instead of waiting on each
+    // other's store
+    constexpr size_t SUB_HISTOGRAMS = 4;
+    
+    // Four sub-histogram copies of one 16-byte bin share a cache line
+    struct HistogramBin {
+        uint32_t count;
+        uint32_t sum_hi;
+        uint32_t sum_mid;
+        uint32_t sum_lo;
+    };
+    static_assert(sizeof(HistogramBin) * SUB_HISTOGRAMS == 64, "one cache line per bin");
+    
+    // Per-thread histogram storage, kept zeroed between calls: only the bins
+    // a region touched are merged, searched and cleared again
+    struct DominantScratch {
+        int bits = 0;
+        std::vector<HistogramBin> bins;  // Bin k, copy j at k * SUB_HISTOGRAMS + j
+        std::vector<uint32_t> touched;   // Bins made non-empty (may repeat across copies)
+    };
+}
 
-#ifdef USE_NEON_SIMD
-// NEON SIMD optimized color accumulation
-// Processes 16 pixels at a time using NEON intrinsics
-inline void accumulateColorsNEON(const cv::Vec3b* img_row, const uchar* mask_row, 
-                                  int width, uint32_t& sum_b, uint32_t& sum_g, 
-                                  uint32_t& sum_r, int& pixel_count) {
-    int x = 0;
-    
-    // NEON accumulators (32-bit to prevent overflow)
-    uint32x4_t acc_b = vdupq_n_u32(0);
-    uint32x4_t acc_g = vdupq_n_u32(0);
-    uint32x4_t acc_r = vdupq_n_u32(0);
-    uint32x4_t acc_count = vdupq_n_u32(0);
-    
-    // Process 16 pixels at a time (NEON optimal width)
-    for (; x + 15 < width; x += 16) {
-        // Load 16 mask bytes
-        uint8x16_t mask_vec = vld1q_u8(mask_row + x);
-        
-        // Check if all masks are zero (early skip optimization)
-        uint64x2_t mask_u64 = vreinterpretq_u64_u8(mask_vec);
-        uint64_t mask_check = vgetq_lane_u64(mask_u64, 0) | vgetq_lane_u64(mask_u64, 1);
-        if (mask_check == 0) {
-            continue; // Skip if all masks are zero
+// Histogram the pixels that for_each_pixel(visit) feeds as visit(hi, mid, lo),
+// quantized to bits per channel, and return the fullest bin (ties go to the
+// lowest bin index, as in the original linear scan)
+template <typename ForEachPixel>
+ColorExtractor::DominantBin ColorExtractor::findDominantBin(int bits, ForEachPixel for_each_pixel) {
+    static thread_local DominantScratch scratch;
+    if (scratch.bits != bits) {
+        scratch.bits = bits;
+        scratch.bins.assign((size_t(1) << (3 * bits)) * SUB_HISTOGRAMS, HistogramBin{0, 0, 0, 0});
+        scratch.touched.clear();
+    }
+    
+    HistogramBin* const bins = scratch.bins.data();
+    std::vector<uint32_t>& touched = scratch.touched;
+    const int shift = 8 - bits;
+    uint32_t lane = 0;
+    
+    for_each_pixel([&](uchar hi, uchar mid, uchar lo) {
+        const uint32_t key = (static_cast<uint32_t>(hi >> shift) << (2 * bits)) |
+                             (static_cast<uint32_t>(mid >> shift) << bits) | (lo >> shift);
+        HistogramBin& bin = bins[key * SUB_HISTOGRAMS + (lane++ & (SUB_HISTOGRAMS - 1))];
+        if (bin.count++ == 0) {
+            touched.push_back(key);
         }
-        
-        // Process in two chunks of 8 pixels each for better register usage
-        for (int chunk = 0; chunk < 2; chunk++) {
-            int offset = x + chunk * 8;
-            
-            // Load 8 BGR pixels (24 bytes)
-            // OpenCV stores as BGR, so we need to deinterleave
-            uint8x8x3_t pixels = vld3_u8(reinterpret_cast<const uint8_t*>(img_row + offset));
-            
-            // Load 8 mask bytes
-            uint8x8_t mask_chunk = vld1_u8(mask_row + offset);
-            
-            // Convert mask to 0 or 0xFF for each pixel
-            uint8x8_t mask_bool = vcgt_u8(mask_chunk, vdup_n_u8(0));
-            
-            // Widen mask to 16-bit for masking operations
-            uint16x8_t mask_wide = vmovl_u8(mask_bool);
-            
-            // Widen pixel values to 16-bit
-            uint16x8_t b_wide = vmovl_u8(pixels.val[0]);
-            uint16x8_t g_wide = vmovl_u8(pixels.val[1]);
-            uint16x8_t r_wide = vmovl_u8(pixels.val[2]);
-            
-            // Apply mask (element-wise AND)
-            b_wide = vandq_u16(b_wide, mask_wide);
-            g_wide = vandq_u16(g_wide, mask_wide);
-            r_wide = vandq_u16(r_wide, mask_wide);
-            
-            // Accumulate into 32-bit accumulators (two halves)
-            // Low 4 elements
-            uint16x4_t b_low = vget_low_u16(b_wide);
-            uint16x4_t g_low = vget_low_u16(g_wide);
-            uint16x4_t r_low = vget_low_u16(r_wide);
-            uint16x4_t mask_low = vget_low_u16(mask_wide);
-            
-            acc_b = vaddq_u32(acc_b, vmovl_u16(b_low));
-            acc_g = vaddq_u32(acc_g, vmovl_u16(g_low));
-            acc_r = vaddq_u32(acc_r, vmovl_u16(r_low));
-            
-            // Convert mask to count: mask_wide is 0xFFFF for valid pixels, 0 otherwise
-            // Right shift by 15 gives us 1 for valid, 0 for invalid
-            uint32x4_t mask_low_32 = vmovl_u16(mask_low);
-            uint32x4_t count_low = vshrq_n_u32(mask_low_32, 15);
-            // But we need to account for the fact that it might be 0xFFFF, not just any value
-            // Actually, vandq gives us the pixel value if mask is 0xFFFF, 0 otherwise
-            // So let's just check if the mask is non-zero
-            uint32x4_t mask_low_bool = vcgtq_u32(mask_low_32, vdupq_n_u32(0));
-            count_low = vandq_u32(mask_low_bool, vdupq_n_u32(1));
-            acc_count = vaddq_u32(acc_count, count_low);
-            
-            // High 4 elements
-            uint16x4_t b_high = vget_high_u16(b_wide);
-            uint16x4_t g_high = vget_high_u16(g_wide);
-            uint16x4_t r_high = vget_high_u16(r_wide);
-            uint16x4_t mask_high = vget_high_u16(mask_wide);
-            
-            acc_b = vaddq_u32(acc_b, vmovl_u16(b_high));
-            acc_g = vaddq_u32(acc_g, vmovl_u16(g_high));
-            acc_r = vaddq_u32(acc_r, vmovl_u16(r_high));
-            
-            uint32x4_t mask_high_32 = vmovl_u16(mask_high);
-            uint32x4_t mask_high_bool = vcgtq_u32(mask_high_32, vdupq_n_u32(0));
-            uint32x4_t count_high = vandq_u32(mask_high_bool, vdupq_n_u32(1));
-            acc_count = vaddq_u32(acc_count, count_high);
+        bin.sum_hi += hi;
+        bin.sum_mid += mid;
+        bin.sum_lo += lo;
+    });
+    
+    // Fold the copies of each touched bin into copy 0 (repeats fold zeros)
+    DominantBin best{0, 0, 0, 0};
+    uint32_t best_key = 0;
+    for (uint32_t key : touched) {
+        HistogramBin* copies = bins + static_cast<size_t>(key) * SUB_HISTOGRAMS;
+        for (size_t j = 1; j < SUB_HISTOGRAMS; j++) {
+            copies[0].count += copies[j].count;
+            copies[0].sum_hi += copies[j].sum_hi;
+            copies[0].sum_mid += copies[j].sum_mid;
+            copies[0].sum_lo += copies[j].sum_lo;
+            copies[j] = HistogramBin{0, 0, 0, 0};
+        }
+        if (copies[0].count > best.count || (copies[0].count == best.count && key < best_key)) {
+            best = DominantBin{copies[0].count, copies[0].sum_hi, copies[0].sum_mid, copies[0].sum_lo};
+            best_key = key;
+        }
+    }
+    
+    for (uint32_t key : touched) {
+        bins[static_cast<size_t>(key) * SUB_HISTOGRAMS] = HistogramBin{0, 0, 0, 0};
+    }
+    touched.clear();
+    return best;
+}
+
+void ColorExtractor::setParallelProcessing(bool enable, int threads, bool pin_threads) {
+    enable_parallel_ = enable;
+    if (!enable) {
+        return;
+    }
+    
+    const size_t wanted = threads > 0 ? static_cast<size_t>(threads)
+                                      : std::max(1u, std::thread::hardware_concurrency());
+    if (!pool_ || pool_->size() != wanted) {
+        pool_.reset();
+        pool_ = std::make_unique<ThreadPool>(wanted, pin_threads);
+        LOG_INFO("Color extraction thread pool: " + std::to_string(wanted) + " threads" +
+                 (pin_threads ? ", pinned to cores" : ""));
+    }
+    if (masks_precomputed_) {
+        buildWorkChunks();
+    }
+}
+
+void ColorExtractor::buildWorkChunks() {
+    const size_t chunks = pool_ ? pool_->size() * CHUNKS_PER_WORKER : 1;
+    std::vector<size_t> cumulative;
+    
+    // LEDs by pixel count: corner slices can be many times larger than edge ones
+    cumulative.assign(1, 0);
+    for (int pixels : led_pixel_counts_) {
+        cumulative.push_back(cumulative.back() + static_cast<size_t>(pixels));
+    }
+    led_chunk_begin_ = balancedChunks(cumulative, chunks);
+    
+    cumulative.assign(1, 0);
+    for (const auto& segment : prefix_segments_) {
+        cumulative.push_back(cumulative.back() + static_cast<size_t>(segment.x1 - segment.x0));
+    }
+    segment_chunk_begin_ = balancedChunks(cumulative, chunks);
+    
+    // Rows by run pixels: the top and bottom bands hold most of the work
+    label_band_begin_ = balancedChunks(label_row_pixels_, chunks);
+    
+    // Per-worker LED sums of the label-map and tiled engines, one cache-line
+    // aligned slice per worker (+16 for aligning the start)
+    band_sums_stride_ = (led_pixel_counts_.size() * 3 + 15) / 16 * 16;
+    band_sums_.assign(pool_ ? band_sums_stride_ * pool_->size() + 16 : 0, 0);
+}
+
+void ColorExtractor::setChangeDetection(bool enable, int block_size, double threshold, int refresh_frames) {
+    change_detection_ = enable;
+    change_block_size_ = std::max(1, block_size);
+    change_threshold_ = std::max(0.0, threshold);
+    change_refresh_frames_ = std::max(0, refresh_frames);
+    last_colors_.clear();
+    if (enable && masks_precomputed_) {
+        buildChangeBlocks();
+    }
+}
+
+void ColorExtractor::buildChangeBlocks() {
+    const int size = change_block_size_;
+    const int blocks_x = (mask_frame_size_.width + size - 1) / size;
+    const int blocks_y = (mask_frame_size_.height + size - 1) / size;
+    
+    // Grid cell -> block index + 1 (0 = no region touches the cell)
+    std::vector<uint32_t> block_of_cell(static_cast<size_t>(blocks_x) * blocks_y, 0);
+    change_blocks_.clear();
+    change_led_block_begin_.assign(1, 0);
+    change_led_blocks_.clear();
+    
+    for (size_t led = 0; led < led_pixel_counts_.size(); led++) {
+        const size_t first = change_led_blocks_.size();
+        for (size_t k = led_span_begin_[led]; k < led_span_begin_[led + 1]; k++) {
+            const RowSpan& span = cached_spans_[k];
+            const int by = span.y / size;
+            for (int bx = span.x0 / size; bx <= (span.x1 - 1) / size; bx++) {
+                uint32_t& block = block_of_cell[static_cast<size_t>(by) * blocks_x + bx];
+                if (block == 0) {
+                    change_blocks_.push_back(cv::Rect(bx * size, by * size, size, size) &
+                                             cv::Rect(0, 0, mask_frame_size_.width, mask_frame_size_.height));
+                    block = static_cast<uint32_t>(change_blocks_.size());
+                }
+                change_led_blocks_.push_back(block - 1);
+            }
         }
+        std::sort(change_led_blocks_.begin() + first, change_led_blocks_.end());
+        change_led_blocks_.erase(std::unique(change_led_blocks_.begin() + first, change_led_blocks_.end()),
+                                 change_led_blocks_.end());
+        change_led_block_begin_.push_back(change_led_blocks_.size());
     }
     
-    // Reduce NEON accumulators to scalars
-    // Using pairwise addition for efficient reduction
-    uint32x2_t acc_b_pair = vadd_u32(vget_low_u32(acc_b), vget_high_u32(acc_b));
-    uint32x2_t acc_g_pair = vadd_u32(vget_low_u32(acc_g), vget_high_u32(acc_g));
-    uint32x2_t acc_r_pair = vadd_u32(vget_low_u32(acc_r), vget_high_u32(acc_r));
-    uint32x2_t acc_count_pair = vadd_u32(vget_low_u32(acc_count), vget_high_u32(acc_count));
+    change_block_sums_.assign(change_blocks_.size() * 3, 0);
+    change_frame_sums_.assign(change_blocks_.size() * 3, 0);
+    change_block_dirty_.assign(change_blocks_.size(), 0);
+    change_led_dirty_.assign(led_pixel_counts_.size(), 0);
+    last_colors_.clear();
     
-    sum_b += vget_lane_u32(vpadd_u32(acc_b_pair, acc_b_pair), 0);
-    sum_g += vget_lane_u32(vpadd_u32(acc_g_pair, acc_g_pair), 0);
-    sum_r += vget_lane_u32(vpadd_u32(acc_r_pair, acc_r_pair), 0);
-    pixel_count += vget_lane_u32(vpadd_u32(acc_count_pair, acc_count_pair), 0);
+    size_t block_pixels = 0;
+    for (const cv::Rect& block : change_blocks_) {
+        block_pixels += static_cast<size_t>(block.area());
+    }
+    LOG_INFO("Change detection: " + std::to_string(change_blocks_.size()) + " blocks of " +
+             std::to_string(size) + "x" + std::to_string(size) + " (" + std::to_string(block_pixels) +
+             " pixels summed per frame), threshold " + std::to_string(change_threshold_) +
+             " levels, full refresh every " + std::to_string(change_refresh_frames_) + " frames");
+}
+
+void ColorExtractor::sumChangeBlocks(const cv::Mat& frame, uint32_t* sums) const {
+    const bool yuv = pixel_format_ == PixelFormat::I420;
+    const int width = frame.cols;
+    const int height = imageHeight(frame);
+    const uchar* u_plane = frame.data + static_cast<size_t>(width) * height;
+    const uchar* v_plane = u_plane + static_cast<size_t>(width / 2) * (height / 2);
     
-    // Process remaining pixels with scalar code
-    for (; x < width; x++) {
-        if (mask_row[x]) {
-            const cv::Vec3b& pixel = img_row[x];
-            sum_b += pixel[0];
-            sum_g += pixel[1];
-            sum_r += pixel[2];
-            pixel_count++;
+    auto sum_blocks = [&](size_t first, size_t last) {
+        for (size_t b = first; b < last; b++) {
+            const cv::Rect& block = change_blocks_[b];
+            uint32_t s0 = 0, s1 = 0, s2 = 0;
+            for (int y = block.y; y < block.y + block.height; y++) {
+                if (yuv) {
+                    SpanKernels::accumulateYUV(frame.ptr<uchar>(y),
+                                               u_plane + static_cast<size_t>(y >> 1) * (width / 2),
+                                               v_plane + static_cast<size_t>(y >> 1) * (width / 2),
+                                               block.x, block.x + block.width, s0, s1, s2);
+                } else {
+                    accumulate_bgr_(frame.ptr<cv::Vec3b>(y), block.x, block.x + block.width, s0, s1, s2);
+                }
+            }
+            sums[b * 3] = s0;
+            sums[b * 3 + 1] = s1;
+            sums[b * 3 + 2] = s2;
         }
+    };
+    
+    // Blocks cost the same, so plain equal ranges balance
+    const size_t blocks = change_blocks_.size();
+    if (runParallel()) {
+        const size_t chunks = std::min(blocks, pool_->size() * CHUNKS_PER_WORKER);
+        pool_->parallelFor(chunks, [&](size_t chunk, size_t) {
+            sum_blocks(blocks * chunk / chunks, blocks * (chunk + 1) / chunks);
+        });
+    } else {
+        sum_blocks(0, blocks);
     }
 }
-#endif
+
+std::vector<cv::Vec3b> ColorExtractor::extractChangedColors(const cv::Mat& frame) {
+    const size_t led_count = led_pixel_counts_.size();
+    const size_t blocks = change_blocks_.size();
+    const bool refresh = last_colors_.size() != led_count ||
+                         (change_refresh_frames_ > 0 && frames_since_refresh_ >= change_refresh_frames_);
+    
+    uint32_t* const current = change_frame_sums_.data();
+    uint32_t* const reference = change_block_sums_.data();
+    sumChangeBlocks(frame, current);
+    
+    // A block is dirty once its mean drifted past the threshold from what its
+    // LEDs were last extracted with; slow fades add up until they count
+    size_t dirty_blocks = 0;
+    for (size_t b = 0; b < blocks; b++) {
+        const int64_t limit = static_cast<int64_t>(change_threshold_ * change_blocks_[b].area());
+        bool dirty = refresh;
+        for (int c = 0; c < 3 && !dirty; c++) {
+            dirty = std::llabs(static_cast<int64_t>(current[b * 3 + c]) - reference[b * 3 + c]) > limit;
+        }
+        change_block_dirty_[b] = dirty;
+        if (dirty) {
+            // Every LED on this block is extracted below, so this is their new baseline
+            reference[b * 3] = current[b * 3];
+            reference[b * 3 + 1] = current[b * 3 + 1];
+            reference[b * 3 + 2] = current[b * 3 + 2];
+            dirty_blocks++;
+        }
+    }
+    
+    size_t dirty_leds = 0;
+    for (size_t led = 0; led < led_count; led++) {
+        bool dirty = false;
+        for (size_t k = change_led_block_begin_[led]; k < change_led_block_begin_[led + 1] && !dirty; k++) {
+            dirty = change_block_dirty_[change_led_blocks_[k]] != 0;
+        }
+        change_led_dirty_[led] = dirty;
+        dirty_leds += dirty ? 1 : 0;
+    }
+    
+    std::vector<cv::Vec3b> colors;
+    if (refresh || dirty_leds == led_count) {
+        colors.resize(led_count);
+        extractRegions(frame, colors, nullptr);
+    } else {
+        colors = last_colors_;
+        if (dirty_leds > 0) {
+            extractRegions(frame, colors, &change_led_dirty_);
+        }
+    }
+    last_colors_ = colors;
+    frames_since_refresh_ = refresh ? 1 : frames_since_refresh_ + 1;
+    
+    change_stats_.frames++;
+    change_stats_.leds += led_count;
+    change_stats_.skipped += led_count - dirty_leds;
+    LOG_DEBUG("Change detection: " + std::to_string(dirty_blocks) + "/" + std::to_string(blocks) +
+              " blocks changed, " + std::to_string(dirty_leds) + "/" + std::to_string(led_count) +
+              " LEDs extracted" + (refresh ? " (refresh)" : ""));
+    return colors;
+}
+
+int ColorExtractor::appendMaskSpans(const cv::Mat& mask, const cv::Rect& bbox, std::vector<RowSpan>& spans) {
+    int pixels = 0;
+    for (int y = 0; y < mask.rows; y++) {
+        const uchar* mask_row = mask.ptr<uchar>(y);
+        int x = 0;
+        while (x < mask.cols) {
+            if (!mask_row[x]) {
+                x++;
+                continue;
+            }
+            const int start = x;
+            while (x < mask.cols && mask_row[x]) {
+                x++;
+            }
+            spans.push_back(RowSpan{bbox.y + y, bbox.x + start, bbox.x + x});
+            pixels += x - start;
+        }
+    }
+    return pixels;
+}
+
+int ColorExtractor::sampleSpans(std::vector<RowSpan>& spans, size_t first, int pixels) const {
+    const std::vector<RowSpan> region(spans.begin() + first, spans.end());
+    spans.resize(first);
+    
+    int x_min = region.front().x0, x_max = region.front().x1;
+    int y_min = region.front().y, y_max = region.front().y + 1;
+    for (const RowSpan& span : region) {
+        x_min = std::min(x_min, span.x0);
+        x_max = std::max(x_max, span.x1);
+        y_min = std::min(y_min, span.y);
+        y_max = std::max(y_max, span.y + 1);
+    }
+    const int width = x_max - x_min;
+    const int height = y_max - y_min;
+    const bool blue_noise = sampling_ == "blue_noise";
+    
+    // Deterministic per-pixel score, the lowest one in a cell is its sample
+    auto hash = [](uint32_t x, uint32_t y) {
+        uint32_t h = x * 0x9E3779B1u ^ y * 0x85EBCA77u;
+        h ^= h >> 15;
+        h *= 0x2C1B3C6Du;
+        h ^= h >> 12;
+        return h;
+    };
+    
+    struct Cell {
+        uint32_t score;
+        int x;
+        int y;
+    };
+    std::vector<Cell> cells;
+    
+    // Cells of about pixels / max_samples_per_led_ pixels, square unless the
+    // region is thinner than that; grown until few enough cells are occupied
+    double area = static_cast<double>(pixels) / max_samples_per_led_;
+    int step_x = 1, step_y = 1;
+    size_t occupied = 0;
+    while (true) {
+        step_y = std::min(height, std::max(1, static_cast<int>(std::lround(std::sqrt(area)))));
+        step_x = std::min(width, std::max(1, static_cast<int>(std::ceil(area / step_y))));
+        const int cells_x = (width + step_x - 1) / step_x;
+        const int cells_y = (height + step_y - 1) / step_y;
+        cells.assign(static_cast<size_t>(cells_x) * cells_y, Cell{UINT32_MAX, 0, 0});
+        
+        occupied = 0;
+        for (const RowSpan& span : region) {
+            const int cy = (span.y - y_min) / step_y;
+            const int dy = 2 * (span.y - y_min - cy * step_y) - (step_y - 1);
+            for (int x = span.x0; x < span.x1; x++) {
+                const int cx = (x - x_min) / step_x;
+                uint32_t score;
+                if (blue_noise) {
+                    score = hash(static_cast<uint32_t>(x), static_cast<uint32_t>(span.y));
+                } else {
+                    // Squared distance to the cell center, in half pixels
+                    const int dx = 2 * (x - x_min - cx * step_x) - (step_x - 1);
+                    score = static_cast<uint32_t>(dx * dx + dy * dy);
+                }
+                Cell& cell = cells[static_cast<size_t>(cy) * cells_x + cx];
+                if (cell.score == UINT32_MAX) {
+                    occupied++;
+                }
+                if (score < cell.score) {
+                    cell = Cell{score, x, span.y};
+                }
+            }
+        }
+        
+        if (occupied <= static_cast<size_t>(max_samples_per_led_) || (step_x == width && step_y == height)) {
+            break;
+        }
+        area *= 1.1;
+    }
+    
+    // Samples as row spans again, in row order; neighbors in a row merge
+    std::vector<std::pair<int, int>> samples;  // (y, x)
+    samples.reserve(occupied);
+    for (const Cell& cell : cells) {
+        if (cell.score != UINT32_MAX) {
+            samples.push_back({cell.y, cell.x});
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+    for (const auto& sample : samples) {
+        if (spans.size() > first && spans.back().y == sample.first && spans.back().x1 == sample.second) {
+            spans.back().x1++;
+        } else {
+            spans.push_back(RowSpan{sample.first, sample.second, sample.second + 1});
+        }
+    }
+    return static_cast<int>(samples.size());
+}
 
 void ColorExtractor::precomputeMasks(const std::vector<std::vector<cv::Point>>& polygons,
                                      int frame_width, int frame_height) {
-    cached_masks_.clear();
     cached_bboxes_.clear();
-    cached_masks_.reserve(polygons.size());
+    cached_spans_.clear();
+    led_span_begin_.clear();
+    led_pixel_counts_.clear();
     cached_bboxes_.reserve(polygons.size());
+    led_span_begin_.reserve(polygons.size() + 1);
+    led_pixel_counts_.reserve(polygons.size());
     
-#ifdef USE_NEON_SIMD
-    LOG_INFO("Pre-computing " + std::to_string(polygons.size()) + " masks with NEON SIMD enabled...");
-#else
-    LOG_INFO("Pre-computing " + std::to_string(polygons.size()) + " masks...");
-#endif
+    LOG_INFO("Pre-computing " + std::to_string(polygons.size()) + " region span lists (" +
+             SpanKernels::isaName(bgr_isa_) + " kernels)...");
     PerformanceTimer timer("Mask pre-computation", false);
     
+    // Rasterize each polygon once with fillPoly (same pixels as a mask) and
+    // keep only its runs; one scratch mask serves all polygons
+    cv::Mat scratch;
+    size_t mask_bytes = 0;
+    size_t covered_pixels = 0;
+    size_t sampled_leds = 0;
     for (const auto& polygon : polygons) {
         cv::Rect bbox = cv::boundingRect(polygon);
         bbox &= cv::Rect(0, 0, frame_width, frame_height);
         
+        led_span_begin_.push_back(cached_spans_.size());
+        cached_bboxes_.push_back(bbox);
+        
         if (bbox.width <= 0 || bbox.height <= 0) {
-            // Empty mask for invalid bounding box
-            cached_masks_.push_back(cv::Mat());
-            cached_bboxes_.push_back(bbox);
+            // No pixels for an invalid bounding box
+            led_pixel_counts_.push_back(0);
             continue;
         }
         
-        // Create mask for this polygon
-        cv::Mat mask = cv::Mat::zeros(bbox.height, bbox.width, CV_8UC1);
+        scratch.create(bbox.height, bbox.width, CV_8UC1);
+        scratch.setTo(cv::Scalar(0));
         std::vector<cv::Point> poly_relative;
         poly_relative.reserve(polygon.size());
         
@@ -167,16 +486,467 @@ void ColorExtractor::precomputeMasks(const std::vector<std::vector<cv::Point>>&
             poly_relative.push_back(cv::Point(pt.x - bbox.x, pt.y - bbox.y));
         }
         
-        cv::fillPoly(mask, std::vector<std::vector<cv::Point>>{poly_relative}, cv::Scalar(255));
-        
-        cached_masks_.push_back(mask);
-        cached_bboxes_.push_back(bbox);
+        cv::fillPoly(scratch, std::vector<std::vector<cv::Point>>{poly_relative}, cv::Scalar(255));
+        int pixels = appendMaskSpans(scratch, bbox, cached_spans_);
+        covered_pixels += static_cast<size_t>(pixels);
+        if (max_samples_per_led_ > 0 && pixels > max_samples_per_led_) {
+            pixels = sampleSpans(cached_spans_, led_span_begin_.back(), pixels);
+            sampled_leds++;
+        }
+        led_pixel_counts_.push_back(pixels);
+        mask_bytes += static_cast<size_t>(bbox.area());
+    }
+    led_span_begin_.push_back(cached_spans_.size());
+    cached_spans_.shrink_to_fit();
+    
+    if (sampled_leds > 0) {
+        size_t read_pixels = 0;
+        for (int pixels : led_pixel_counts_) {
+            read_pixels += static_cast<size_t>(pixels);
+        }
+        LOG_INFO("Sampling (" + sampling_ + "): " + std::to_string(sampled_leds) + " of " +
+                 std::to_string(polygons.size()) + " regions capped at " + std::to_string(max_samples_per_led_) +
+                 " pixels, " + std::to_string(read_pixels) + " of " + std::to_string(covered_pixels) +
+                 " covered pixels read per frame");
+    }
+    
+    mask_frame_size_ = cv::Size(frame_width, frame_height);
+    if (change_detection_) {
+        buildChangeBlocks();
     }
     
+    if (engine_ == "integral") {
+        buildIntegralLayout(frame_height);
+    } else if (engine_ == "label_map") {
+        buildLabelMap(frame_height);
+    } else if (engine_ == "tiled") {
+        buildTiles(frame_height);
+    }
+    
+    buildWorkChunks();
+    
     timer.stop();
     masks_precomputed_ = true;
     LOG_INFO("Mask pre-computation completed in " + 
-             std::to_string(timer.elapsedMilliseconds()) + " ms");
+             std::to_string(timer.elapsedMilliseconds()) + " ms: " +
+             std::to_string(cached_spans_.size()) + " spans, " +
+             std::to_string(cached_spans_.size() * sizeof(RowSpan) / 1024) + " KiB (masks: " +
+             std::to_string(mask_bytes / 1024) + " KiB)");
+}
+
+void ColorExtractor::buildIntegralLayout(int frame_height) {
+    // Runs of every region, grouped by image row
+    size_t masked_pixels = 0;
+    std::vector<std::vector<std::pair<int, int>>> runs_by_row(std::max(frame_height, 0));
+    for (const RowSpan& span : cached_spans_) {
+        runs_by_row[span.y].push_back({span.x0, span.x1});
+        masked_pixels += static_cast<size_t>(span.x1 - span.x0);
+    }
+    
+    // Merge overlapping runs of each row: every covered pixel is summed once per frame
+    prefix_segments_.clear();
+    prefix_entries_ = 0;
+    std::vector<size_t> row_first_segment(runs_by_row.size() + 1, 0);
+    for (size_t y = 0; y < runs_by_row.size(); y++) {
+        row_first_segment[y] = prefix_segments_.size();
+        auto& runs = runs_by_row[y];
+        std::sort(runs.begin(), runs.end());
+        for (const auto& run : runs) {
+            if (prefix_segments_.size() > row_first_segment[y] && run.first <= prefix_segments_.back().x1) {
+                prefix_segments_.back().x1 = std::max(prefix_segments_.back().x1, run.second);
+                continue;
+            }
+            prefix_segments_.push_back(PrefixSegment{static_cast<int>(y), run.first, run.second, 0});
+        }
+    }
+    row_first_segment[runs_by_row.size()] = prefix_segments_.size();
+    
+    size_t covered_pixels = 0;
+    for (auto& segment : prefix_segments_) {
+        segment.offset = prefix_entries_;
+        prefix_entries_ += static_cast<size_t>(segment.x1 - segment.x0) + 1;
+        covered_pixels += static_cast<size_t>(segment.x1 - segment.x0);
+    }
+    
+    // Point every span at the prefix entries around it (same index as cached_spans_)
+    span_lookups_.clear();
+    span_lookups_.reserve(cached_spans_.size());
+    for (const RowSpan& span : cached_spans_) {
+        auto first = prefix_segments_.begin() + row_first_segment[span.y];
+        auto last = prefix_segments_.begin() + row_first_segment[span.y + 1];
+        auto segment = std::upper_bound(first, last, span.x0, [](int x, const PrefixSegment& s) {
+            return x < s.x0;
+        }) - 1;
+        span_lookups_.push_back(SpanLookup{segment->offset + (span.x0 - segment->x0),
+                                           segment->offset + (span.x1 - segment->x0)});
+    }
+    
+    LOG_INFO("Integral engine: " + std::to_string(span_lookups_.size()) + " row spans in " +
+             std::to_string(prefix_segments_.size()) + " prefix segments, " +
+             std::to_string(covered_pixels) + " pixels summed per frame (regions cover " +
+             std::to_string(masked_pixels) + ")");
+}
+
+template <PixelFormat Format, bool Gamma>
+cv::Vec3b ColorExtractor::meanFromSums(uint32_t sum0, uint32_t sum1, uint32_t sum2, int count, int led_index) const {
+    cv::Vec3b color;
+    if constexpr (Format == PixelFormat::I420) {
+        color = yuvToRGB(static_cast<double>(sum0) / count, static_cast<double>(sum1) / count,
+                         static_cast<double>(sum2) / count);
+    } else {
+        // Convert BGR to RGB
+        color = cv::Vec3b(static_cast<uchar>(sum2 / count), static_cast<uchar>(sum1 / count),
+                          static_cast<uchar>(sum0 / count));
+    }
+    if constexpr (Gamma) {
+        color = applyGammaCorrection(color, led_index);
+    }
+    return color;
+}
+
+template <PixelFormat Format, bool Gamma>
+std::vector<cv::Vec3b> ColorExtractor::resolveMeanColors(const uint32_t* sums) const {
+    const size_t led_count = led_pixel_counts_.size();
+    std::vector<cv::Vec3b> colors(led_count, cv::Vec3b(0, 0, 0));
+    for (size_t led = 0; led < led_count; led++) {
+        const int count = led_pixel_counts_[led];
+        if (count > 0) {
+            const uint32_t* acc = sums + led * 3;
+            colors[led] = meanFromSums<Format, Gamma>(acc[0], acc[1], acc[2], count, static_cast<int>(led));
+        }
+    }
+    return colors;
+}
+
+template <typename RunBand>
+const uint32_t* ColorExtractor::parallelBandSums(size_t bands, RunBand run_band) {
+    const size_t values = led_pixel_counts_.size() * 3;
+    const size_t workers = pool_ ? pool_->size() : 1;
+    if (!runParallel() || band_sums_.size() < band_sums_stride_ * workers + 16) {
+        // Per thread so concurrent callers (batch workers) don't share sums
+        static thread_local std::vector<uint32_t> sums;
+        sums.assign(values, 0);
+        for (size_t band = 0; band < bands; band++) {
+            run_band(band, sums.data());
+        }
+        return sums.data();
+    }
+    
+    // Each worker adds into its own sums; strides are whole cache lines so
+    // no two workers ever write to the same line
+    uint32_t* base = band_sums_.data();
+    base += (64 - reinterpret_cast<uintptr_t>(base) % 64) % 64 / sizeof(uint32_t);
+    std::fill(base, base + band_sums_stride_ * workers, 0);
+    
+    pool_->parallelFor(bands, [&](size_t band, size_t worker) {
+        run_band(band, base + worker * band_sums_stride_);
+    });
+    for (size_t worker = 1; worker < workers; worker++) {
+        const uint32_t* partial = base + worker * band_sums_stride_;
+        for (size_t i = 0; i < values; i++) {
+            base[i] += partial[i];
+        }
+    }
+    return base;
+}
+
+template <PixelFormat Format, bool Gamma>
+std::vector<cv::Vec3b> ColorExtractor::extractColorsIntegral(const cv::Mat& frame) {
+    const size_t led_count = led_pixel_counts_.size();
+    std::vector<cv::Vec3b> colors(led_count, cv::Vec3b(0, 0, 0));
+    
+    // Per thread so concurrent callers (batch workers) don't share sums.
+    // Entry e holds the three channel sums of the segment's pixels before e.
+    static thread_local std::vector<uint32_t> prefix;
+    prefix.resize(prefix_entries_ * 3);
+    uint32_t* const sums = prefix.data();
+    
+    constexpr bool yuv = Format == PixelFormat::I420;
+    const int width = frame.cols;
+    const int height = imageHeight(frame);
+    const uchar* u_plane = frame.data + static_cast<size_t>(width) * height;
+    const uchar* v_plane = u_plane + static_cast<size_t>(width / 2) * (height / 2);
+    
+    auto build_segment = [&](const PrefixSegment& segment) {
+        uint32_t* p = sums + segment.offset * 3;
+        uint32_t s0 = 0, s1 = 0, s2 = 0;
+        p[0] = p[1] = p[2] = 0;
+        p += 3;
+        if constexpr (yuv) {
+            const uchar* y_row = frame.ptr<uchar>(segment.y);
+            const uchar* u_row = u_plane + static_cast<size_t>(segment.y >> 1) * (width / 2);
+            const uchar* v_row = v_plane + static_cast<size_t>(segment.y >> 1) * (width / 2);
+            for (int x = segment.x0; x < segment.x1; x++, p += 3) {
+                p[0] = s0 += y_row[x];
+                p[1] = s1 += u_row[x >> 1];
+                p[2] = s2 += v_row[x >> 1];
+            }
+        } else {
+            const cv::Vec3b* row = frame.ptr<cv::Vec3b>(segment.y);
+            for (int x = segment.x0; x < segment.x1; x++, p += 3) {
+                p[0] = s0 += row[x][0];
+                p[1] = s1 += row[x][1];
+                p[2] = s2 += row[x][2];
+            }
+        }
+    };
+    
+    auto resolve_led = [&](size_t led) {
+        const int count = led_pixel_counts_[led];
+        if (count == 0) {
+            return;
+        }
+        uint32_t c0 = 0, c1 = 0, c2 = 0;
+        for (size_t k = led_span_begin_[led]; k < led_span_begin_[led + 1]; k++) {
+            const uint32_t* a = sums + span_lookups_[k].begin * 3;
+            const uint32_t* b = sums + span_lookups_[k].end * 3;
+            c0 += b[0] - a[0];
+            c1 += b[1] - a[1];
+            c2 += b[2] - a[2];
+        }
+        colors[led] = meanFromSums<Format, Gamma>(c0, c1, c2, count, static_cast<int>(led));
+    };
+    
+    if (runParallel()) {
+        pool_->parallelFor(segment_chunk_begin_.size() - 1, [&](size_t chunk, size_t) {
+            for (size_t i = segment_chunk_begin_[chunk]; i < segment_chunk_begin_[chunk + 1]; i++) {
+                build_segment(prefix_segments_[i]);
+            }
+        });
+        pool_->parallelFor(led_chunk_begin_.size() - 1, [&](size_t chunk, size_t) {
+            for (size_t led = led_chunk_begin_[chunk]; led < led_chunk_begin_[chunk + 1]; led++) {
+                resolve_led(led);
+            }
+        });
+        return colors;
+    }
+    for (const auto& segment : prefix_segments_) {
+        build_segment(segment);
+    }
+    for (size_t led = 0; led < led_count; led++) {
+        resolve_led(led);
+    }
+    return colors;
+}
+
+void ColorExtractor::buildLabelMap(int frame_height) {
+    struct LabeledSpan {
+        int x0;
+        int x1;
+        uint32_t led;
+    };
+    
+    // Spans of every LED, grouped by image row
+    std::vector<std::vector<LabeledSpan>> spans_by_row(std::max(frame_height, 0));
+    for (size_t led = 0; led + 1 < led_span_begin_.size(); led++) {
+        for (size_t k = led_span_begin_[led]; k < led_span_begin_[led + 1]; k++) {
+            const RowSpan& span = cached_spans_[k];
+            spans_by_row[span.y].push_back(LabeledSpan{span.x0, span.x1, static_cast<uint32_t>(led)});
+        }
+    }
+    
+    label_runs_.clear();
+    label_overflow_.clear();
+    label_row_begin_.assign(spans_by_row.size() + 1, 0);
+    label_row_pixels_.assign(spans_by_row.size() + 1, 0);
+    
+    size_t covered_pixels = 0;
+    size_t shared_pixels = 0;
+    std::vector<int> cuts;
+    std::vector<uint32_t> labels;
+    for (size_t y = 0; y < spans_by_row.size(); y++) {
+        label_row_begin_[y] = label_runs_.size();
+        label_row_pixels_[y] = covered_pixels;
+        const auto& row = spans_by_row[y];
+        
+        // Between two consecutive span ends the set of covering LEDs is constant
+        cuts.clear();
+        for (const auto& span : row) {
+            cuts.push_back(span.x0);
+            cuts.push_back(span.x1);
+        }
+        std::sort(cuts.begin(), cuts.end());
+        cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+        
+        for (size_t c = 0; c + 1 < cuts.size(); c++) {
+            const int x0 = cuts[c];
+            const int x1 = cuts[c + 1];
+            labels.clear();
+            for (const auto& span : row) {
+                if (span.x0 <= x0 && span.x1 >= x1) {
+                    labels.push_back(span.led);
+                }
+            }
+            if (labels.empty()) {
+                continue;  // Gap between regions
+            }
+            covered_pixels += static_cast<size_t>(x1 - x0);
+            
+            if (labels.size() == 1) {
+                // Extend the previous run when the same LED continues across a cut
+                if (label_runs_.size() > label_row_begin_[y] && label_runs_.back().count == 1 &&
+                    label_runs_.back().label == labels[0] && label_runs_.back().x1 == x0) {
+                    label_runs_.back().x1 = x1;
+                } else {
+                    label_runs_.push_back(LabelRun{x0, x1, labels[0], 1});
+                }
+                continue;
+            }
+            
+            // Overflow: pixels shared by overlapping regions list all their LEDs
+            label_runs_.push_back(LabelRun{x0, x1, static_cast<uint32_t>(label_overflow_.size()),
+                                           static_cast<uint32_t>(labels.size())});
+            label_overflow_.insert(label_overflow_.end(), labels.begin(), labels.end());
+            shared_pixels += static_cast<size_t>(x1 - x0);
+        }
+    }
+    label_row_begin_[spans_by_row.size()] = label_runs_.size();
+    label_row_pixels_[spans_by_row.size()] = covered_pixels;
+    
+    LOG_INFO("Label-map engine: " + std::to_string(label_runs_.size()) + " label runs, " +
+             std::to_string(covered_pixels) + " pixels read per frame (" +
+             std::to_string(shared_pixels) + " shared by several LEDs)");
+}
+
+template <PixelFormat Format, bool Gamma>
+std::vector<cv::Vec3b> ColorExtractor::extractColorsLabelMap(const cv::Mat& frame) {
+    constexpr bool yuv = Format == PixelFormat::I420;
+    const int width = frame.cols;
+    const int height = imageHeight(frame);
+    const uchar* u_plane = frame.data + static_cast<size_t>(width) * height;
+    const uchar* v_plane = u_plane + static_cast<size_t>(width / 2) * (height / 2);
+    
+    // Read rows [row_begin, row_end) in order, every covered pixel exactly once,
+    // and add each run's channel sums to the LEDs it belongs to
+    auto stream_rows = [&](int row_begin, int row_end, uint32_t* sums) {
+        for (int y = row_begin; y < row_end; y++) {
+            const size_t first = label_row_begin_[y];
+            const size_t last = label_row_begin_[y + 1];
+            if (first == last) {
+                continue;
+            }
+            const uchar* y_row = frame.ptr<uchar>(y);
+            const uchar* u_row = u_plane + static_cast<size_t>(y >> 1) * (width / 2);
+            const uchar* v_row = v_plane + static_cast<size_t>(y >> 1) * (width / 2);
+            
+            for (size_t r = first; r < last; r++) {
+                const LabelRun& run = label_runs_[r];
+                uint32_t s0 = 0, s1 = 0, s2 = 0;
+                if constexpr (yuv) {
+                    SpanKernels::accumulateYUV(y_row, u_row, v_row, run.x0, run.x1, s0, s1, s2);
+                } else {
+                    accumulate_bgr_(reinterpret_cast<const cv::Vec3b*>(y_row), run.x0, run.x1, s0, s1, s2);
+                }
+                
+                const uint32_t* leds = run.count == 1 ? &run.label : label_overflow_.data() + run.label;
+                for (uint32_t k = 0; k < run.count; k++) {
+                    uint32_t* acc = sums + static_cast<size_t>(leds[k]) * 3;
+                    acc[0] += s0;
+                    acc[1] += s1;
+                    acc[2] += s2;
+                }
+            }
+        }
+    };
+    
+    const uint32_t* sums = parallelBandSums(label_band_begin_.size() - 1, [&](size_t band, uint32_t* band_sums) {
+        stream_rows(static_cast<int>(label_band_begin_[band]), static_cast<int>(label_band_begin_[band + 1]),
+                    band_sums);
+    });
+    return resolveMeanColors<Format, Gamma>(sums);
+}
+
+void ColorExtractor::buildTiles(int frame_height) {
+    // Frame bytes each row's spans touch (shared pixels counted per LED, so
+    // bands rather come out a little small)
+    const size_t pixel_bytes = pixel_format_ == PixelFormat::I420 ? 2 : 3;
+    std::vector<size_t> row_bytes(std::max(frame_height, 0), 0);
+    for (const RowSpan& span : cached_spans_) {
+        row_bytes[span.y] += static_cast<size_t>(span.x1 - span.x0) * pixel_bytes;
+    }
+    
+    // Greedy bands from the top, at least one row each. Half the L2 by
+    // default leaves room for the sums and whatever else the core runs
+    const size_t budget = tile_bytes_ > 0 ? tile_bytes_ : l2CacheBytes() / 2;
+    tile_band_rows_.assign(1, 0);
+    std::vector<uint32_t> band_of_row(row_bytes.size(), 0);
+    size_t band_bytes = 0;
+    for (size_t y = 0; y < row_bytes.size(); y++) {
+        if (band_bytes > 0 && band_bytes + row_bytes[y] > budget) {
+            tile_band_rows_.push_back(static_cast<int>(y));
+            band_bytes = 0;
+        }
+        band_bytes += row_bytes[y];
+        band_of_row[y] = static_cast<uint32_t>(tile_band_rows_.size() - 1);
+    }
+    tile_band_rows_.push_back(static_cast<int>(row_bytes.size()));
+    const size_t bands = tile_band_rows_.size() - 1;
+    
+    // An LED's spans are in row order, so its spans in one band are contiguous
+    std::vector<std::vector<TileEntry>> entries_by_band(bands);
+    for (size_t led = 0; led < led_pixel_counts_.size(); led++) {
+        size_t k = led_span_begin_[led];
+        const size_t last = led_span_begin_[led + 1];
+        while (k < last) {
+            const uint32_t band = band_of_row[cached_spans_[k].y];
+            const size_t first = k;
+            while (k < last && band_of_row[cached_spans_[k].y] == band) {
+                k++;
+            }
+            entries_by_band[band].push_back(
+                TileEntry{static_cast<uint32_t>(led), static_cast<uint32_t>(first), static_cast<uint32_t>(k)});
+        }
+    }
+    
+    tile_entries_.clear();
+    tile_band_begin_.assign(1, 0);
+    for (const auto& entries : entries_by_band) {
+        tile_entries_.insert(tile_entries_.end(), entries.begin(), entries.end());
+        tile_band_begin_.push_back(tile_entries_.size());
+    }
+    
+    size_t touched = 0;
+    for (size_t bytes : row_bytes) {
+        touched += bytes;
+    }
+    LOG_INFO("Tiled engine: " + std::to_string(bands) + " row bands of up to " + std::to_string(budget / 1024) +
+             " KiB, " + std::to_string(tile_entries_.size()) + " LED band entries, " +
+             std::to_string(touched / 1024) + " KiB of spans per frame");
+}
+
+template <PixelFormat Format, bool Gamma>
+std::vector<cv::Vec3b> ColorExtractor::extractColorsTiled(const cv::Mat& frame) {
+    constexpr bool yuv = Format == PixelFormat::I420;
+    const int width = frame.cols;
+    const int height = imageHeight(frame);
+    const uchar* u_plane = frame.data + static_cast<size_t>(width) * height;
+    const uchar* v_plane = u_plane + static_cast<size_t>(width / 2) * (height / 2);
+    
+    // All LEDs crossing one band back to back: the band's rows are fetched
+    // from memory once and every later LED on them hits the cache
+    auto run_band = [&](size_t band, uint32_t* sums) {
+        for (size_t e = tile_band_begin_[band]; e < tile_band_begin_[band + 1]; e++) {
+            const TileEntry& entry = tile_entries_[e];
+            uint32_t s0 = 0, s1 = 0, s2 = 0;
+            for (uint32_t k = entry.span_begin; k < entry.span_end; k++) {
+                const RowSpan& span = cached_spans_[k];
+                if constexpr (yuv) {
+                    SpanKernels::accumulateYUV(frame.ptr<uchar>(span.y),
+                                               u_plane + static_cast<size_t>(span.y >> 1) * (width / 2),
+                                               v_plane + static_cast<size_t>(span.y >> 1) * (width / 2),
+                                               span.x0, span.x1, s0, s1, s2);
+                } else {
+                    accumulate_bgr_(frame.ptr<cv::Vec3b>(span.y), span.x0, span.x1, s0, s1, s2);
+                }
+            }
+            uint32_t* acc = sums + static_cast<size_t>(entry.led) * 3;
+            acc[0] += s0;
+            acc[1] += s1;
+            acc[2] += s2;
+        }
+    };
+    
+    return resolveMeanColors<Format, Gamma>(parallelBandSums(tile_band_begin_.size() - 1, run_band));
 }
 
 std::vector<cv::Vec3b> ColorExtractor::extractColors(
@@ -193,49 +963,33 @@ std::vector<cv::Vec3b> ColorExtractor::extractColors(
     
     PerformanceTimer timer("Color extraction", false);
     
-    // Use pre-computed masks if available, otherwise fall back to dynamic creation
-    if (masks_precomputed_ && cached_masks_.size() == polygons.size()) {
-        // Fast path: use pre-computed masks
-        #ifdef _OPENMP
-        if (enable_parallel_) {
-            #pragma omp parallel for schedule(dynamic, 4)
-            for (int idx = 0; idx < static_cast<int>(polygons.size()); idx++) {
-                colors[idx] = extractSingleColorWithMask(frame, cached_masks_[idx], cached_bboxes_[idx], idx);
-            }
+    // Use pre-computed spans if available, otherwise fall back to dynamic creation
+    if (masks_precomputed_ && led_pixel_counts_.size() == polygons.size()) {
+        if (change_detection_ && !change_led_block_begin_.empty()) {
+            // Only LEDs on changed blocks, the rest keep last frame's colors
+            colors = extractChangedColors(frame);
         } else {
-            for (size_t idx = 0; idx < polygons.size(); idx++) {
-                colors[idx] = extractSingleColorWithMask(frame, cached_masks_[idx], cached_bboxes_[idx], idx);
-            }
+            extractRegions(frame, colors, nullptr);
         }
-        #else
-        for (size_t idx = 0; idx < polygons.size(); idx++) {
-            colors[idx] = extractSingleColorWithMask(frame, cached_masks_[idx], cached_bboxes_[idx], idx);
-        }
-        #endif
     } else {
         // Fallback: compute masks dynamically (original behavior)
         std::vector<cv::Rect> bboxes(polygons.size());
         for (size_t i = 0; i < polygons.size(); i++) {
             bboxes[i] = cv::boundingRect(polygons[i]);
-            bboxes[i] &= cv::Rect(0, 0, frame.cols, frame.rows);
+            bboxes[i] &= cv::Rect(0, 0, frame.cols, imageHeight(frame));
         }
         
-        #ifdef _OPENMP
-        if (enable_parallel_) {
-            #pragma omp parallel for schedule(dynamic, 4)
-            for (int idx = 0; idx < static_cast<int>(polygons.size()); idx++) {
-                colors[idx] = extractSingleColor(frame, polygons[idx], bboxes[idx], idx);
-            }
+        // No pixel counts yet: one task per LED, stealing evens out the sizes
+        auto extract = [&](size_t idx, size_t) {
+            colors[idx] = extractSingleColor(frame, polygons[idx], bboxes[idx], static_cast<int>(idx));
+        };
+        if (runParallel()) {
+            pool_->parallelFor(polygons.size(), extract);
         } else {
             for (size_t idx = 0; idx < polygons.size(); idx++) {
-                colors[idx] = extractSingleColor(frame, polygons[idx], bboxes[idx], idx);
+                extract(idx, 0);
             }
         }
-        #else
-        for (size_t idx = 0; idx < polygons.size(); idx++) {
-            colors[idx] = extractSingleColor(frame, polygons[idx], bboxes[idx], idx);
-        }
-        #endif
     }
     
     timer.stop();
@@ -248,194 +1002,198 @@ std::vector<cv::Vec3b> ColorExtractor::extractColors(
     return colors;
 }
 
-cv::Vec3b ColorExtractor::extractSingleColorWithMask(const cv::Mat& frame,
-                                                    const cv::Mat& mask,
-                                                    const cv::Rect& bbox,
-                                                    int led_index) {
-    if (bbox.width <= 0 || bbox.height <= 0 || mask.empty()) {
-        return cv::Vec3b(0, 0, 0);
+void ColorExtractor::extractRegions(const cv::Mat& frame, std::vector<cv::Vec3b>& colors,
+                                    const std::vector<uchar>* dirty) {
+    if (frame_kernel_ && !dirty) {
+        // Whole-frame engine: integral prefix sums or a single label-map pass
+        colors = (this->*frame_kernel_)(frame);
+        return;
     }
     
-    // Route to appropriate extraction method
-    if (method_ == "dominant") {
-        return extractDominantColor(frame, mask, bbox, led_index);
+    // Fast path: use pre-computed spans (the engines give the same colors)
+    auto extract = [&](size_t first, size_t last) {
+        for (size_t idx = first; idx < last; idx++) {
+            if (!dirty || (*dirty)[idx]) {
+                colors[idx] = (this->*region_kernel_)(frame, ledSpans(idx), static_cast<int>(idx));
+            }
+        }
+    };
+    if (runParallel()) {
+        pool_->parallelFor(led_chunk_begin_.size() - 1, [&](size_t chunk, size_t) {
+            extract(led_chunk_begin_[chunk], led_chunk_begin_[chunk + 1]);
+        });
     } else {
-        return extractMeanColor(frame, mask, bbox, led_index);
+        extract(0, colors.size());
     }
 }
 
-cv::Vec3b ColorExtractor::extractMeanColor(const cv::Mat& frame,
-                                           const cv::Mat& mask,
-                                           const cv::Rect& bbox,
-                                           int led_index) {
-    if (bbox.width <= 0 || bbox.height <= 0 || mask.empty()) {
-        return cv::Vec3b(0, 0, 0);
-    }
-    
-    // Color accumulators
-    uint32_t sum_b = 0, sum_g = 0, sum_r = 0;
-    int pixel_count = 0;
+template <PixelFormat Format>
+cv::Vec3b ColorExtractor::meanColor(const cv::Mat& frame, const SpanList& region) const {
+    // Color accumulators; only covered pixels are read, no mask bytes, no per-pixel compares
+    uint32_t sum0 = 0, sum1 = 0, sum2 = 0;
     
-#ifdef USE_NEON_SIMD
-    // NEON SIMD optimized path - processes 16 pixels at a time
-    for (int y = 0; y < bbox.height; y++) {
-        const uchar* mask_row = mask.ptr<uchar>(y);
-        const cv::Vec3b* img_row = frame.ptr<cv::Vec3b>(bbox.y + y) + bbox.x;
+    if constexpr (Format == PixelFormat::I420) {
+        const int width = frame.cols;
+        const int height = imageHeight(frame);
+        const uchar* u_plane = frame.data + static_cast<size_t>(width) * height;
+        const uchar* v_plane = u_plane + static_cast<size_t>(width / 2) * (height / 2);
         
-        accumulateColorsNEON(img_row, mask_row, bbox.width, 
-                            sum_b, sum_g, sum_r, pixel_count);
-    }
-#else
-    // Scalar fallback for non-ARM platforms
-    for (int y = 0; y < bbox.height; y++) {
-        const uchar* mask_row = mask.ptr<uchar>(y);
-        const cv::Vec3b* img_row = frame.ptr<cv::Vec3b>(bbox.y + y) + bbox.x;
-        
-        for (int x = 0; x < bbox.width; x++) {
-            if (mask_row[x]) {
-                const cv::Vec3b& pixel = img_row[x];
-                sum_b += pixel[0];
-                sum_g += pixel[1];
-                sum_r += pixel[2];
-                pixel_count++;
-            }
+        for (size_t i = 0; i < region.count; i++) {
+            const RowSpan& span = region.spans[i];
+            const uchar* y_row = frame.ptr<uchar>(span.y);
+            const uchar* u_row = u_plane + static_cast<size_t>(span.y >> 1) * (width / 2);
+            const uchar* v_row = v_plane + static_cast<size_t>(span.y >> 1) * (width / 2);
+            
+            SpanKernels::accumulateYUV(y_row, u_row, v_row, span.x0, span.x1, sum0, sum1, sum2);
         }
-    }
-#endif
-    
-    if (pixel_count > 0) {
-        // Convert BGR to RGB
-        uchar r = static_cast<uchar>(sum_r / pixel_count);
-        uchar g = static_cast<uchar>(sum_g / pixel_count);
-        uchar b = static_cast<uchar>(sum_b / pixel_count);
-        cv::Vec3b color(r, g, b);
         
-        // Apply gamma correction if enabled
-        return applyGammaCorrection(color, led_index);
+    } else {
+        for (size_t i = 0; i < region.count; i++) {
+            const RowSpan& span = region.spans[i];
+            accumulate_bgr_(frame.ptr<cv::Vec3b>(span.y), span.x0, span.x1, sum0, sum1, sum2);
+        }
     }
-    
-    return cv::Vec3b(0, 0, 0);
+    return meanFromSums<Format, false>(sum0, sum1, sum2, region.pixels, 0);
 }
 
-cv::Vec3b ColorExtractor::extractDominantColor(const cv::Mat& frame,
-                                               const cv::Mat& mask,
-                                               const cv::Rect& bbox,
-                                               int led_index) {
-    if (bbox.width <= 0 || bbox.height <= 0 || mask.empty()) {
-        return cv::Vec3b(0, 0, 0);
-    }
-    
-    // Use histogram-based approach for performance
-    // Quantize colors to 8 bins per channel (512 total bins)
-    constexpr int bins_per_channel = 8;
-    constexpr int bin_shift = 8 - 3;  // 2^3 = 8 bins
-    constexpr int total_bins = bins_per_channel * bins_per_channel * bins_per_channel;
-    
-    // Count pixels in each quantized color bin
-    std::vector<int> histogram(total_bins, 0);
-    std::vector<uint32_t> sum_b(total_bins, 0);
-    std::vector<uint32_t> sum_g(total_bins, 0);
-    std::vector<uint32_t> sum_r(total_bins, 0);
-    int total_pixels = 0;
-    
-    // Build histogram (scalar implementation - SIMD not beneficial for histogram updates)
-    for (int y = 0; y < bbox.height; y++) {
-        const uchar* mask_row = mask.ptr<uchar>(y);
-        const cv::Vec3b* img_row = frame.ptr<cv::Vec3b>(bbox.y + y) + bbox.x;
+template <PixelFormat Format>
+cv::Vec3b ColorExtractor::dominantColor(const cv::Mat& frame, const SpanList& region) const {
+    if constexpr (Format == PixelFormat::I420) {
+        const int width = frame.cols;
+        const int height = imageHeight(frame);
+        const uchar* u_plane = frame.data + static_cast<size_t>(width) * height;
+        const uchar* v_plane = u_plane + static_cast<size_t>(width / 2) * (height / 2);
         
-        for (int x = 0; x < bbox.width; x++) {
-            if (mask_row[x]) {
-                const cv::Vec3b& pixel = img_row[x];
-                
-                // Quantize to bin indices
-                int b_bin = pixel[0] >> bin_shift;
-                int g_bin = pixel[1] >> bin_shift;
-                int r_bin = pixel[2] >> bin_shift;
-                
-                // Compute linear bin index
-                int bin_idx = (r_bin * bins_per_channel * bins_per_channel) + 
-                             (g_bin * bins_per_channel) + b_bin;
-                
-                histogram[bin_idx]++;
-                sum_b[bin_idx] += pixel[0];
-                sum_g[bin_idx] += pixel[1];
-                sum_r[bin_idx] += pixel[2];
-                total_pixels++;
+        // Bins keyed (y, u, v)
+        DominantBin bin = findDominantBin(dominant_bits_, [&](auto&& visit) {
+            for (size_t i = 0; i < region.count; i++) {
+                const RowSpan& span = region.spans[i];
+                const uchar* y_row = frame.ptr<uchar>(span.y);
+                const uchar* u_row = u_plane + static_cast<size_t>(span.y >> 1) * (width / 2);
+                const uchar* v_row = v_plane + static_cast<size_t>(span.y >> 1) * (width / 2);
+                for (int col = span.x0; col < span.x1; col++) {
+                    visit(y_row[col], u_row[col >> 1], v_row[col >> 1]);
+                }
+            }
+        });
+        
+        if (bin.count == 0) {
+            return cv::Vec3b(0, 0, 0);
+        }
+        return yuvToRGB(static_cast<double>(bin.sum_hi) / bin.count,
+                        static_cast<double>(bin.sum_mid) / bin.count,
+                        static_cast<double>(bin.sum_lo) / bin.count);
+    } else {
+        // Bins keyed (r, g, b) from the most significant bits down
+        DominantBin bin = findDominantBin(dominant_bits_, [&](auto&& visit) {
+            for (size_t i = 0; i < region.count; i++) {
+                const RowSpan& span = region.spans[i];
+                const cv::Vec3b* img_row = frame.ptr<cv::Vec3b>(span.y);
+                for (int x = span.x0; x < span.x1; x++) {
+                    const cv::Vec3b& pixel = img_row[x];
+                    visit(pixel[2], pixel[1], pixel[0]);
+                }
             }
+        });
+        
+        if (bin.count == 0) {
+            return cv::Vec3b(0, 0, 0);
         }
+        
+        // Calculate average color within the dominant bin
+        return cv::Vec3b(static_cast<uchar>(bin.sum_hi / bin.count),
+                         static_cast<uchar>(bin.sum_mid / bin.count),
+                         static_cast<uchar>(bin.sum_lo / bin.count));
     }
-    
-    if (total_pixels == 0) {
+}
+
+template <ColorExtractor::Method M, PixelFormat Format, bool Gamma>
+cv::Vec3b ColorExtractor::extractRegion(const cv::Mat& frame, const SpanList& region, int led_index) {
+    if (region.pixels == 0) {
         return cv::Vec3b(0, 0, 0);
     }
     
-    // Find the bin with the most pixels (dominant color)
-    int max_bin = 0;
-    int max_count = histogram[0];
-    
-#ifdef USE_NEON_SIMD
-    // NEON optimization for finding maximum in histogram
-    // Process 4 elements at a time
-    int32x4_t max_count_vec = vdupq_n_s32(histogram[0]);
-    const int32_t init_bins[4] = {0, 1, 2, 3};
-    int32x4_t max_bin_vec = vld1q_s32(init_bins);
-    int32x4_t idx_increment = vdupq_n_s32(4);
-    int32x4_t current_idx = vld1q_s32(init_bins);
-    
-    for (int i = 0; i < total_bins - 3; i += 4) {
-        int32x4_t hist_vec = vld1q_s32(reinterpret_cast<const int32_t*>(&histogram[i]));
-        uint32x4_t cmp = vcgtq_s32(hist_vec, max_count_vec);
-        
-        // Update max values where comparison is true
-        max_count_vec = vbslq_s32(cmp, hist_vec, max_count_vec);
-        max_bin_vec = vbslq_s32(cmp, current_idx, max_bin_vec);
-        
-        current_idx = vaddq_s32(current_idx, idx_increment);
+    cv::Vec3b color = M == Method::Dominant ? dominantColor<Format>(frame, region)
+                                            : meanColor<Format>(frame, region);
+    if constexpr (Gamma) {
+        return applyGammaCorrection(color, led_index);
     }
+    return color;
+}
+
+void ColorExtractor::resolveKernels() {
+    // [method][pixel format][gamma]
+    static constexpr RegionKernel region_kernels[2][2][2] = {
+        {{&ColorExtractor::extractRegion<Method::Mean, PixelFormat::BGR, false>,
+          &ColorExtractor::extractRegion<Method::Mean, PixelFormat::BGR, true>},
+         {&ColorExtractor::extractRegion<Method::Mean, PixelFormat::I420, false>,
+          &ColorExtractor::extractRegion<Method::Mean, PixelFormat::I420, true>}},
+        {{&ColorExtractor::extractRegion<Method::Dominant, PixelFormat::BGR, false>,
+          &ColorExtractor::extractRegion<Method::Dominant, PixelFormat::BGR, true>},
+         {&ColorExtractor::extractRegion<Method::Dominant, PixelFormat::I420, false>,
+          &ColorExtractor::extractRegion<Method::Dominant, PixelFormat::I420, true>}}
+    };
+    // [pixel format][gamma]
+    static constexpr FrameKernel integral_kernels[2][2] = {
+        {&ColorExtractor::extractColorsIntegral<PixelFormat::BGR, false>,
+         &ColorExtractor::extractColorsIntegral<PixelFormat::BGR, true>},
+        {&ColorExtractor::extractColorsIntegral<PixelFormat::I420, false>,
+         &ColorExtractor::extractColorsIntegral<PixelFormat::I420, true>}
+    };
+    static constexpr FrameKernel label_map_kernels[2][2] = {
+        {&ColorExtractor::extractColorsLabelMap<PixelFormat::BGR, false>,
+         &ColorExtractor::extractColorsLabelMap<PixelFormat::BGR, true>},
+        {&ColorExtractor::extractColorsLabelMap<PixelFormat::I420, false>,
+         &ColorExtractor::extractColorsLabelMap<PixelFormat::I420, true>}
+    };
     
-    // Reduce NEON results to scalar
-    int32_t counts[4], bins[4];
-    vst1q_s32(counts, max_count_vec);
-    vst1q_s32(bins, max_bin_vec);
+    static constexpr FrameKernel tiled_kernels[2][2] = {
+        {&ColorExtractor::extractColorsTiled<PixelFormat::BGR, false>,
+         &ColorExtractor::extractColorsTiled<PixelFormat::BGR, true>},
+        {&ColorExtractor::extractColorsTiled<PixelFormat::I420, false>,
+         &ColorExtractor::extractColorsTiled<PixelFormat::I420, true>}
+    };
     
-    max_count = counts[0];
-    max_bin = bins[0];
-    for (int i = 1; i < 4; i++) {
-        if (counts[i] > max_count) {
-            max_count = counts[i];
-            max_bin = bins[i];
-        }
-    }
+    const int method = method_ == "dominant" ? 1 : 0;
+    const int format = pixel_format_ == PixelFormat::I420 ? 1 : 0;
+    const int gamma = gamma_enabled_ ? 1 : 0;
     
-    // Handle remaining elements
-    for (int i = (total_bins & ~3); i < total_bins; i++) {
-        if (histogram[i] > max_count) {
-            max_count = histogram[i];
-            max_bin = i;
-        }
-    }
-#else
-    // Scalar fallback
-    for (int i = 1; i < total_bins; i++) {
-        if (histogram[i] > max_count) {
-            max_count = histogram[i];
-            max_bin = i;
-        }
+    region_kernel_ = region_kernels[method][format][gamma];
+    last_colors_.clear();  // Carried-over colors came from the old kernels
+    
+    // The whole-frame engines only compute means
+    frame_kernel_ = nullptr;
+    if (method_ == "mean" && engine_ == "integral") {
+        frame_kernel_ = integral_kernels[format][gamma];
+    } else if (method_ == "mean" && engine_ == "label_map") {
+        frame_kernel_ = label_map_kernels[format][gamma];
+    } else if (method_ == "mean" && engine_ == "tiled") {
+        frame_kernel_ = tiled_kernels[format][gamma];
     }
-#endif
+}
+
+cv::Vec3b ColorExtractor::yuvToRGB(double y, double u, double v) const {
+    // Limited-range YCbCr, same coefficients as cv::COLOR_YUV2BGR_I420 for BT.601.
+    // rpicam-vid tags SD video streams as SMPTE170M (BT.601) and HD ones as Rec709.
+    double c = 1.164 * (y - 16.0);
+    double d = u - 128.0;
+    double e = v - 128.0;
     
-    // Calculate average color within the dominant bin
-    if (max_count > 0) {
-        uchar r = static_cast<uchar>(sum_r[max_bin] / max_count);
-        uchar g = static_cast<uchar>(sum_g[max_bin] / max_count);
-        uchar b = static_cast<uchar>(sum_b[max_bin] / max_count);
-        cv::Vec3b color(r, g, b);
-        
-        // Apply gamma correction if enabled
-        return applyGammaCorrection(color, led_index);
+    double r, g, b;
+    if (yuv_rec709_) {
+        r = c + 1.793 * e;
+        g = c - 0.213 * d - 0.533 * e;
+        b = c + 2.112 * d;
+    } else {
+        r = c + 1.596 * e;
+        g = c - 0.391 * d - 0.813 * e;
+        b = c + 2.018 * d;
     }
     
-    return cv::Vec3b(0, 0, 0);
+    auto to_byte = [](double value) {
+        return static_cast<uchar>(std::min(255.0, std::max(0.0, value + 0.5)));
+    };
+    return cv::Vec3b(to_byte(r), to_byte(g), to_byte(b));
 }
 
 cv::Vec3b ColorExtractor::extractSingleColor(const cv::Mat& frame,
@@ -446,7 +1204,7 @@ cv::Vec3b ColorExtractor::extractSingleColor(const cv::Mat& frame,
         return cv::Vec3b(0, 0, 0);
     }
     
-    // Create minimal mask for scanline processing
+    // Rasterize the polygon and extract from its row spans
     cv::Mat mask = cv::Mat::zeros(bbox.height, bbox.width, CV_8UC1);
     std::vector<cv::Point> poly_relative;
     poly_relative.reserve(polygon.size());
@@ -457,44 +1215,44 @@ cv::Vec3b ColorExtractor::extractSingleColor(const cv::Mat& frame,
     
     cv::fillPoly(mask, std::vector<std::vector<cv::Point>>{poly_relative}, cv::Scalar(255));
     
-    // Use the optimized mask-based extraction
-    return extractSingleColorWithMask(frame, mask, bbox, led_index);
+    std::vector<RowSpan> spans;
+    SpanList region;
+    region.pixels = appendMaskSpans(mask, bbox, spans);
+    region.spans = spans.data();
+    region.count = spans.size();
+    return (this->*region_kernel_)(frame, region, led_index);
 }
 
-void ColorExtractor::buildAllGammaLUTs() {
-    buildGammaLUT(corner_gamma_top_left_);
-    buildGammaLUT(corner_gamma_top_center_);
-    buildGammaLUT(corner_gamma_top_right_);
-    buildGammaLUT(corner_gamma_right_center_);
-    buildGammaLUT(corner_gamma_bottom_right_);
-    buildGammaLUT(corner_gamma_bottom_center_);
-    buildGammaLUT(corner_gamma_bottom_left_);
-    buildGammaLUT(corner_gamma_left_center_);
+uchar ColorExtractor::gammaCorrect(uchar value, double gamma) {
+    // Normalize to [0, 1] range
+    double normalized = value / 255.0;
     
-    LOG_DEBUG("All 8-point gamma correction LUTs built");
+    // Apply gamma correction: output = input^(1/gamma)
+    // This converts from linear light to display gamma
+    double corrected = std::pow(normalized, 1.0 / gamma);
+    
+    // Scale back to [0, 255] and clamp
+    return static_cast<uchar>(std::min(255.0, std::max(0.0, corrected * 255.0 + 0.5)));
 }
 
-void ColorExtractor::buildGammaLUT(CornerGamma& corner_gamma) {
-    // Pre-compute gamma correction lookup tables for fast processing
-    corner_gamma.lut_red.resize(256);
-    corner_gamma.lut_green.resize(256);
-    corner_gamma.lut_blue.resize(256);
+void ColorExtractor::buildLEDGammaLUTs() {
+    // Same blend and rounding as the per-pixel formula, evaluated once per
+    // possible input value instead of once per LED per frame
+    const int led_count = led_counts_.getTotalLEDs();
+    led_gamma_luts_.resize(static_cast<size_t>(led_count) * 3 * 256);
     
-    for (int i = 0; i < 256; i++) {
-        // Normalize to [0, 1] range
-        double normalized = i / 255.0;
-        
-        // Apply gamma correction: output = input^(1/gamma)
-        // This converts from linear light to display gamma
-        double corrected_r = std::pow(normalized, 1.0 / corner_gamma.gamma_red);
-        double corrected_g = std::pow(normalized, 1.0 / corner_gamma.gamma_green);
-        double corrected_b = std::pow(normalized, 1.0 / corner_gamma.gamma_blue);
-        
-        // Scale back to [0, 255] and clamp
-        corner_gamma.lut_red[i] = static_cast<uchar>(std::min(255.0, std::max(0.0, corrected_r * 255.0 + 0.5)));
-        corner_gamma.lut_green[i] = static_cast<uchar>(std::min(255.0, std::max(0.0, corrected_g * 255.0 + 0.5)));
-        corner_gamma.lut_blue[i] = static_cast<uchar>(std::min(255.0, std::max(0.0, corrected_b * 255.0 + 0.5)));
+    for (int led = 0; led < led_count; led++) {
+        BlendedGamma gamma = calculateBlendedGamma(led);
+        uchar* lut = led_gamma_luts_.data() + static_cast<size_t>(led) * 3 * 256;
+        for (int i = 0; i < 256; i++) {
+            lut[i] = gammaCorrect(static_cast<uchar>(i), gamma.red);
+            lut[256 + i] = gammaCorrect(static_cast<uchar>(i), gamma.green);
+            lut[512 + i] = gammaCorrect(static_cast<uchar>(i), gamma.blue);
+        }
     }
+    
+    last_colors_.clear();  // Carried-over colors used the old tables
+    LOG_DEBUG("Gamma correction LUTs built for " + std::to_string(led_count) + " LEDs");
 }
 
 ColorExtractor::BlendedGamma ColorExtractor::calculateBlendedGamma(int led_index) const {
@@ -638,29 +1396,17 @@ ColorExtractor::BlendedGamma ColorExtractor::calculateBlendedGamma(int led_index
 }
 
 cv::Vec3b ColorExtractor::applyGammaCorrection(const cv::Vec3b& color, int led_index) const {
-    if (!gamma_enabled_) {
-        return color;
+    if (led_index >= 0 && static_cast<size_t>(led_index) < led_gamma_luts_.size() / (3 * 256)) {
+        const uchar* lut = led_gamma_luts_.data() + static_cast<size_t>(led_index) * 3 * 256;
+        return cv::Vec3b(lut[color[0]], lut[256 + color[1]], lut[512 + color[2]]);
     }
     
-    // Get blended gamma values for this LED
+    // No table for this index (no layout set, or more regions than LEDs):
+    // blend on the fly
     BlendedGamma gamma = calculateBlendedGamma(led_index);
-    
-    // Apply gamma correction using the blended gamma values
-    // We need to compute on-the-fly for blended gammas
-    double normalized_r = color[0] / 255.0;
-    double normalized_g = color[1] / 255.0;
-    double normalized_b = color[2] / 255.0;
-    
-    double corrected_r = std::pow(normalized_r, 1.0 / gamma.red);
-    double corrected_g = std::pow(normalized_g, 1.0 / gamma.green);
-    double corrected_b = std::pow(normalized_b, 1.0 / gamma.blue);
-    
-    // Scale back to [0, 255] and clamp
-    uchar final_r = static_cast<uchar>(std::min(255.0, std::max(0.0, corrected_r * 255.0 + 0.5)));
-    uchar final_g = static_cast<uchar>(std::min(255.0, std::max(0.0, corrected_g * 255.0 + 0.5)));
-    uchar final_b = static_cast<uchar>(std::min(255.0, std::max(0.0, corrected_b * 255.0 + 0.5)));
-    
-    return cv::Vec3b(final_r, final_g, final_b);
+    return cv::Vec3b(gammaCorrect(color[0], gamma.red),
+                     gammaCorrect(color[1], gamma.green),
+                     gammaCorrect(color[2], gamma.blue));
 }
 
 } // namespace TVLED
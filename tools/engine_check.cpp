@@ -0,0 +1,206 @@
+// Checks that the integral, label_map and tiled engines produce exactly the
+// colors of the per-LED mask loops on random overlapping regions, for BGR and
+// I420 frames, with gamma off and on, sequential and on the thread pool. Run it
+// after touching any extraction engine.
+//
+//   engine_check                  # default frame size and layouts
+//   engine_check --layouts 50     # more random region layouts
+
+#include "processing/ColorExtractor.h"
+#include "utils/Logger.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace TVLED;
+
+namespace {
+
+struct Layout {
+    int top;
+    int bottom;
+    int left;
+    int right;
+    std::vector<std::vector<cv::Point>> polygons;
+};
+
+void printUsage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [OPTIONS]\n\n"
+              << "Options:\n"
+              << "  --size <WxH>    Frame size, even (default: 640x360)\n"
+              << "  --layouts <n>   Random region layouts checked (default: 10)\n"
+              << "  --seed <n>      Random seed (default: 1)\n"
+              << "  --help          Show this help message\n";
+}
+
+// Edge slices like the Coons grid produces, jittered so neighbors overlap,
+// some corners pushed out of the frame, plus a few stray triangles
+Layout randomLayout(std::mt19937& rng, int width, int height) {
+    Layout layout;
+    layout.top = 4 + static_cast<int>(rng() % 12);
+    layout.bottom = 4 + static_cast<int>(rng() % 12);
+    layout.left = 2 + static_cast<int>(rng() % 8);
+    layout.right = 2 + static_cast<int>(rng() % 8);
+
+    auto jitter = [&](int range) { return static_cast<int>(rng() % (2 * range + 1)) - range; };
+    const int band_y = height / 5;
+    const int band_x = width / 8;
+
+    auto slices = [&](int count, bool horizontal, int fixed0, int fixed1) {
+        const int length = horizontal ? width : height;
+        for (int i = 0; i < count; i++) {
+            const int a = length * i / count + jitter(6);
+            const int b = length * (i + 1) / count + jitter(6);
+            std::vector<cv::Point> quad;
+            if (horizontal) {
+                quad = {{a, fixed0 + jitter(4)}, {b, fixed0 + jitter(4)}, {b + jitter(8), fixed1}, {a + jitter(8), fixed1}};
+            } else {
+                quad = {{fixed0 + jitter(4), a}, {fixed0 + jitter(4), b}, {fixed1, b + jitter(8)}, {fixed1, a + jitter(8)}};
+            }
+            layout.polygons.push_back(quad);
+        }
+    };
+    slices(layout.left, false, -3, band_x);
+    slices(layout.top, true, -3, band_y);
+    slices(layout.right, false, width + 2, width - 1 - band_x);
+    slices(layout.bottom, true, height + 2, height - 1 - band_y);
+
+    // Replace a few slices with triangles anywhere, overlapping everything
+    for (int i = 0; i < 3; i++) {
+        auto& polygon = layout.polygons[rng() % layout.polygons.size()];
+        polygon.clear();
+        for (int k = 0; k < 3; k++) {
+            polygon.push_back(cv::Point(static_cast<int>(rng() % (width + 20)) - 10,
+                                        static_cast<int>(rng() % (height + 20)) - 10));
+        }
+    }
+    return layout;
+}
+
+cv::Mat randomFrame(std::mt19937& rng, int width, int height, bool i420) {
+    cv::Mat frame = i420 ? cv::Mat(height * 3 / 2, width, CV_8UC1) : cv::Mat(height, width, CV_8UC3);
+    const size_t bytes = frame.total() * frame.elemSize();
+    for (size_t i = 0; i < bytes; i++) {
+        // Include the 0 and 255 extremes
+        const uint32_t r = rng() % 10;
+        frame.data[i] = static_cast<uchar>(r == 0 ? 0 : r == 1 ? 255 : rng() % 256);
+    }
+    return frame;
+}
+
+void configure(ColorExtractor& extractor, const Layout& layout, const std::string& engine, bool i420,
+               bool gamma, int threads, int max_samples, const std::vector<double>& gammas) {
+    extractor.setParallelProcessing(threads > 1, threads);
+    extractor.setMethod("mean");
+    extractor.setEngine(engine);
+    extractor.setSampling(max_samples, "blue_noise");
+    // Small bands, so the tiled engine crosses many band edges
+    extractor.setTileBytes(8 * 1024);
+    extractor.setPixelFormat(i420 ? PixelFormat::I420 : PixelFormat::BGR);
+    extractor.setLEDLayout(layout.top, layout.bottom, layout.left, layout.right);
+    const double* g = gammas.data();
+    extractor.setEightPointGammaCorrection(gamma,
+                                           g[0], g[1], g[2], g[3], g[4], g[5], g[6], g[7],
+                                           g[8], g[9], g[10], g[11], g[12], g[13], g[14], g[15],
+                                           g[16], g[17], g[18], g[19], g[20], g[21], g[22], g[23]);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int width = 640;
+    int height = 360;
+    int layouts = 10;
+    unsigned seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2) {
+                std::cerr << "Invalid --size, expected WxH\n";
+                return 1;
+            }
+        } else if (arg == "--layouts" && i + 1 < argc) {
+            layouts = std::atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (width < 16 || height < 16 || width % 2 || height % 2 || layouts <= 0) {
+        std::cerr << "Frame size must be even and at least 16x16, layouts positive\n";
+        return 1;
+    }
+
+    Logger::getInstance().setLevel(LogLevel::ERROR);
+    std::mt19937 rng(seed);
+
+    const std::vector<std::string> engines = {"integral", "label_map", "tiled"};
+    size_t checks = 0;
+    size_t failures = 0;
+
+    for (int l = 0; l < layouts; l++) {
+        const Layout layout = randomLayout(rng, width, height);
+        std::vector<double> gammas(24);
+        for (double& g : gammas) {
+            g = 1.0 + (rng() % 2000) / 1000.0;
+        }
+
+        for (bool i420 : {false, true}) {
+            const cv::Mat frame = randomFrame(rng, width, height, i420);
+            for (bool gamma : {false, true}) {
+                for (int threads : {1, 4}) {
+                    for (int max_samples : {0, 64}) {
+                        ColorExtractor reference;
+                        configure(reference, layout, "mask", i420, gamma, threads, max_samples, gammas);
+                        reference.precomputeMasks(layout.polygons, width, height);
+                        const std::vector<cv::Vec3b> expected = reference.extractColors(frame, layout.polygons);
+
+                        for (const std::string& engine : engines) {
+                            ColorExtractor extractor;
+                            configure(extractor, layout, engine, i420, gamma, threads, max_samples, gammas);
+                            extractor.precomputeMasks(layout.polygons, width, height);
+                            const std::vector<cv::Vec3b> colors = extractor.extractColors(frame, layout.polygons);
+                            checks++;
+
+                            size_t mismatches = 0;
+                            size_t first = 0;
+                            for (size_t led = 0; led < expected.size(); led++) {
+                                if (led >= colors.size() || colors[led] != expected[led]) {
+                                    if (mismatches++ == 0) {
+                                        first = led;
+                                    }
+                                }
+                            }
+                            if (mismatches > 0 || colors.size() != expected.size()) {
+                                failures++;
+                                std::cout << "  MISMATCH layout " << l << ", " << engine << ", "
+                                          << (i420 ? "I420" : "BGR") << ", gamma " << (gamma ? "on" : "off")
+                                          << ", " << threads << " threads, "
+                                          << (max_samples ? "sampled" : "all pixels") << ": " << mismatches
+                                          << " of " << expected.size() << " LEDs differ, first LED " << first
+                                          << "\n";
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::cout << "Engine check: " << checks << " engine runs against the mask loops on " << layouts
+              << " layouts at " << width << "x" << height << ", " << (failures == 0 ? "all exact" : "FAILED")
+              << " (" << failures << " mismatching)\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+// Checks that every span kernel this CPU can run produces exactly the sums of
+// the scalar loop, and reports their throughput: the BGR kernels and the I420
+// kernel (NEON on ARM builds). Run it on new hardware (or after touching
+// processing/SpanKernels.h) before trusting the dispatched kernel.
+//
+//   kernel_check                 # verify and benchmark all supported kernels
+//   kernel_check --spans 200000  # more random spans per kernel
+
+#include "processing/SpanKernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace TVLED;
+
+namespace {
+
+struct Span {
+    int y;
+    int x0;
+    int x1;
+};
+
+void printUsage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [OPTIONS]\n\n"
+              << "Options:\n"
+              << "  --width <n>     Row width in pixels (default: 1920)\n"
+              << "  --spans <n>     Random spans checked per kernel (default: 50000)\n"
+              << "  --seed <n>      Random seed (default: 1)\n"
+              << "  --help          Show this help message\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int width = 1920;
+    int span_count = 50000;
+    unsigned seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--width" && i + 1 < argc) {
+            width = std::atoi(argv[++i]);
+        } else if (arg == "--spans" && i + 1 < argc) {
+            span_count = std::atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (width <= 0 || span_count <= 0) {
+        std::cerr << "Width and span count must be positive\n";
+        return 1;
+    }
+
+    // Random pixels, including the 0 and 255 extremes
+    constexpr int rows = 64;
+    std::mt19937 rng(seed);
+    std::vector<cv::Vec3b> image(static_cast<size_t>(width) * rows);
+    for (auto& pixel : image) {
+        for (int c = 0; c < 3; c++) {
+            const uint32_t r = rng() % 10;
+            pixel[c] = static_cast<uchar>(r == 0 ? 0 : r == 1 ? 255 : rng() % 256);
+        }
+    }
+
+    // Short spans hit the tails, long ones the vector loops; every start
+    // offset mod 32 occurs so unaligned loads are exercised
+    std::vector<Span> spans(static_cast<size_t>(span_count));
+    for (auto& span : spans) {
+        const int max_length = rng() % 4 == 0 ? width : 80;
+        span.y = static_cast<int>(rng() % rows);
+        span.x0 = static_cast<int>(rng() % width);
+        span.x1 = std::min(width, span.x0 + static_cast<int>(rng() % (max_length + 1)));
+    }
+
+    auto run = [&](SpanKernels::AccumulateBGR kernel, std::vector<uint32_t>& sums) {
+        sums.assign(spans.size() * 3, 0);
+        for (size_t i = 0; i < spans.size(); i++) {
+            const cv::Vec3b* row = image.data() + static_cast<size_t>(spans[i].y) * width;
+            kernel(row, spans[i].x0, spans[i].x1, sums[i * 3], sums[i * 3 + 1], sums[i * 3 + 2]);
+        }
+    };
+
+    std::vector<uint32_t> reference;
+    run(SpanKernels::accumulateBGRScalar, reference);
+    size_t pixels = 0;
+    for (const auto& span : spans) {
+        pixels += static_cast<size_t>(span.x1 - span.x0);
+    }
+
+    std::cout << "Checking span kernels against scalar: " << spans.size() << " spans, "
+              << pixels << " pixels, best kernel for this CPU: "
+              << SpanKernels::isaName(SpanKernels::bestIsa()) << "\n";
+
+    bool all_exact = true;
+    std::vector<uint32_t> sums;
+    for (SpanKernels::Isa isa : {SpanKernels::Isa::Scalar, SpanKernels::Isa::NEON,
+                                 SpanKernels::Isa::SSE41, SpanKernels::Isa::AVX2}) {
+        SpanKernels::AccumulateBGR kernel = SpanKernels::bgrKernel(isa);
+        if (!kernel) {
+            std::cout << "  " << std::left << std::setw(8) << SpanKernels::isaName(isa) << "not supported\n";
+            continue;
+        }
+
+        run(kernel, sums);
+        size_t mismatches = 0;
+        size_t first_mismatch = 0;
+        for (size_t i = 0; i < spans.size(); i++) {
+            if (sums[i * 3] != reference[i * 3] || sums[i * 3 + 1] != reference[i * 3 + 1] ||
+                sums[i * 3 + 2] != reference[i * 3 + 2]) {
+                if (mismatches++ == 0) {
+                    first_mismatch = i;
+                }
+            }
+        }
+
+        // Best of a few timed passes
+        double best_ms = 0;
+        for (int pass = 0; pass < 5; pass++) {
+            auto start = std::chrono::steady_clock::now();
+            run(kernel, sums);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            best_ms = pass == 0 ? ms : std::min(best_ms, ms);
+        }
+
+        std::cout << "  " << std::left << std::setw(8) << SpanKernels::isaName(isa)
+                  << (mismatches == 0 ? "exact   " : "MISMATCH") << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(8) << pixels / (best_ms * 1000.0) << " Mpix/s\n";
+        if (mismatches > 0) {
+            const Span& span = spans[first_mismatch];
+            std::cout << "    " << mismatches << " spans differ, first: row " << span.y << " ["
+                      << span.x0 << ", " << span.x1 << ")\n";
+            all_exact = false;
+        }
+    }
+
+    // I420: a luma plane and half-width chroma rows, same spans
+    const int chroma_width = (width + 1) / 2;
+    std::vector<uchar> luma(static_cast<size_t>(width) * rows);
+    std::vector<uchar> chroma_u(static_cast<size_t>(chroma_width) * rows);
+    std::vector<uchar> chroma_v(chroma_u.size());
+    for (std::vector<uchar>* plane : {&luma, &chroma_u, &chroma_v}) {
+        for (auto& value : *plane) {
+            const uint32_t r = rng() % 10;
+            value = static_cast<uchar>(r == 0 ? 0 : r == 1 ? 255 : rng() % 256);
+        }
+    }
+
+    auto run_yuv = [&](bool scalar, std::vector<uint32_t>& yuv_sums) {
+        yuv_sums.assign(spans.size() * 3, 0);
+        for (size_t i = 0; i < spans.size(); i++) {
+            const uchar* y_row = luma.data() + static_cast<size_t>(spans[i].y) * width;
+            const uchar* u_row = chroma_u.data() + static_cast<size_t>(spans[i].y) * chroma_width;
+            const uchar* v_row = chroma_v.data() + static_cast<size_t>(spans[i].y) * chroma_width;
+            (scalar ? SpanKernels::accumulateYUVScalar : SpanKernels::accumulateYUV)(
+                y_row, u_row, v_row, spans[i].x0, spans[i].x1,
+                yuv_sums[i * 3], yuv_sums[i * 3 + 1], yuv_sums[i * 3 + 2]);
+        }
+    };
+
+    std::vector<uint32_t> yuv_reference;
+    run_yuv(true, yuv_reference);
+    run_yuv(false, sums);
+    size_t yuv_mismatches = 0;
+    size_t yuv_first_mismatch = 0;
+    for (size_t i = 0; i < spans.size(); i++) {
+        if (sums[i * 3] != yuv_reference[i * 3] || sums[i * 3 + 1] != yuv_reference[i * 3 + 1] ||
+            sums[i * 3 + 2] != yuv_reference[i * 3 + 2]) {
+            if (yuv_mismatches++ == 0) {
+                yuv_first_mismatch = i;
+            }
+        }
+    }
+
+    double yuv_best_ms = 0;
+    for (int pass = 0; pass < 5; pass++) {
+        auto start = std::chrono::steady_clock::now();
+        run_yuv(false, sums);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        yuv_best_ms = pass == 0 ? ms : std::min(yuv_best_ms, ms);
+    }
+
+    std::cout << "Checking I420 span kernel against scalar:\n"
+              << "  " << std::left << std::setw(8) << SpanKernels::isaName(SpanKernels::yuvIsa())
+              << (yuv_mismatches == 0 ? "exact   " : "MISMATCH") << std::right << std::fixed
+              << std::setprecision(1) << std::setw(8) << pixels / (yuv_best_ms * 1000.0) << " Mpix/s\n";
+    if (yuv_mismatches > 0) {
+        const Span& span = spans[yuv_first_mismatch];
+        std::cout << "    " << yuv_mismatches << " spans differ, first: row " << span.y << " ["
+                  << span.x0 << ", " << span.x1 << ")\n";
+        all_exact = false;
+    }
+
+    return all_exact ? 0 : 1;
+}
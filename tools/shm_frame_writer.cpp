@@ -0,0 +1,203 @@
+// Publishes frames into a shared-memory frame ring for testing the "shm" mode
+// without a capture daemon. Frames are generated (moving color bars) or read
+// from a video file, and written straight into the ring slots.
+//
+//   shm_frame_writer --name /tvled-frames --size 1280x720 --fps 60
+//   shm_frame_writer --video capture.mp4 --format i420
+
+#include "utils/ShmFrameRing.h"
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <string>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace TVLED;
+
+namespace {
+
+std::atomic<bool> should_exit(false);
+
+void signalHandler(int) {
+    should_exit = true;
+}
+
+void printUsage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [OPTIONS]\n\n"
+              << "Options:\n"
+              << "  --name <name>        Shared memory object (default: /tvled-frames)\n"
+              << "  --size <WxH>         Frame size (default: 1280x720)\n"
+              << "  --format <bgr|i420>  Pixel format (default: bgr)\n"
+              << "  --fps <n>            Frames per second, 0 = as fast as possible (default: 30)\n"
+              << "  --slots <n>          Ring depth (default: 4)\n"
+              << "  --video <path>       Publish frames from a video file (looped) instead of color bars\n"
+              << "  --frames <n>         Stop after n frames (default: run until interrupted)\n"
+              << "  --help               Show this help message\n";
+}
+
+// Moving vertical bars, rendered into a BGR frame
+void renderBars(cv::Mat& bgr, uint64_t index) {
+    static const cv::Vec3b colors[] = {
+        {191, 191, 191}, {0, 191, 191}, {191, 191, 0}, {0, 191, 0},
+        {191, 0, 191}, {0, 0, 191}, {191, 0, 0}, {0, 0, 0}
+    };
+    const int offset = static_cast<int>((index * 4) % bgr.cols);
+    cv::Vec3b* row = bgr.ptr<cv::Vec3b>(0);
+    for (int x = 0; x < bgr.cols; x++) {
+        row[x] = colors[((x + offset) % bgr.cols) * 8 / bgr.cols];
+    }
+    const size_t row_bytes = static_cast<size_t>(bgr.cols) * 3;
+    for (int y = 1; y < bgr.rows; y++) {
+        std::memcpy(bgr.ptr(y), row, row_bytes);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string name = "/tvled-frames";
+    std::string format = "bgr";
+    std::string video_path;
+    int width = 1280;
+    int height = 720;
+    int fps = 30;
+    int slots = 4;
+    long long max_frames = 0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--name" && i + 1 < argc) {
+            name = argv[++i];
+        } else if (arg == "--size" && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2) {
+                std::cerr << "Invalid --size, expected WxH\n";
+                return 1;
+            }
+        } else if (arg == "--format" && i + 1 < argc) {
+            format = argv[++i];
+        } else if (arg == "--fps" && i + 1 < argc) {
+            fps = std::atoi(argv[++i]);
+        } else if (arg == "--slots" && i + 1 < argc) {
+            slots = std::atoi(argv[++i]);
+        } else if (arg == "--video" && i + 1 < argc) {
+            video_path = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            max_frames = std::atoll(argv[++i]);
+        } else if (arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    const bool i420 = format == "i420";
+    if ((format != "bgr" && !i420) || width <= 0 || height <= 0 || fps < 0 || slots < 2 ||
+        (i420 && (width % 2 || height % 2))) {
+        std::cerr << "Invalid options (format bgr|i420, positive size, even size for i420, slots >= 2)\n";
+        return 1;
+    }
+
+    cv::VideoCapture video;
+    if (!video_path.empty() && !video.open(video_path)) {
+        std::cerr << "Failed to open video: " << video_path << "\n";
+        return 1;
+    }
+
+    ShmFrameRing::Header layout;
+    ShmFrameRing::describe(layout, width, height, i420 ? ShmFrameRing::FORMAT_I420 : ShmFrameRing::FORMAT_BGR,
+                           slots);
+    const size_t size = ShmFrameRing::mappingSize(layout);
+
+    // Recreate the object so readers never see a ring with a different layout
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        std::cerr << "Failed to create shared memory " << name << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "Failed to map shared memory: " << std::strerror(errno) << "\n";
+        shm_unlink(name.c_str());
+        return 1;
+    }
+
+    // Fresh mapping is zeroed, so every slot starts with sequence 0
+    auto* header = new (base) ShmFrameRing::Header();
+    ShmFrameRing::describe(*header, width, height, layout.format, slots);
+    header->published.store(0);
+    header->futex.store(0);
+    header->writer_pid.store(static_cast<int32_t>(getpid()));
+
+    std::signal(SIGINT, signalHandler);
+    std::signal(SIGTERM, signalHandler);
+
+    std::cout << "Publishing " << width << "x" << height << " " << format << " frames to " << name
+              << " (" << slots << " slots, " << size / 1024 << " KiB)\n";
+
+    cv::Mat source;
+    cv::Mat bgr(height, width, CV_8UC3);
+    const auto interval = fps > 0 ? std::chrono::microseconds(1000000 / fps) : std::chrono::microseconds(0);
+    auto next = std::chrono::steady_clock::now();
+    uint64_t index = 0;
+
+    while (!should_exit && (max_frames <= 0 || static_cast<long long>(index) < max_frames)) {
+        if (video.isOpened()) {
+            if (!video.read(source)) {
+                video.set(cv::CAP_PROP_POS_FRAMES, 0);
+                if (!video.read(source)) {
+                    std::cerr << "Failed to read from video\n";
+                    break;
+                }
+            }
+            cv::resize(source, bgr, bgr.size());
+        } else {
+            renderBars(bgr, index);
+        }
+
+        const uint64_t timestamp = ShmFrameRing::monotonicNanoseconds();
+        ShmFrameRing::publish(base, *header, timestamp, [&](uint8_t* data) {
+            if (i420) {
+                cv::Mat yuv(height * 3 / 2, width, CV_8UC1, data);
+                cv::cvtColor(bgr, yuv, cv::COLOR_BGR2YUV_I420);
+            } else {
+                cv::Mat dst(height, width, CV_8UC3, data, header->stride);
+                bgr.copyTo(dst);
+            }
+        });
+        index++;
+
+        if (fps > 0) {
+            next += interval;
+            auto now = std::chrono::steady_clock::now();
+            if (next < now) {
+                next = now;
+            } else {
+                std::this_thread::sleep_until(next);
+            }
+        }
+    }
+
+    // Readers treat pid 0 as a clean shutdown
+    header->writer_pid.store(0);
+    ShmFrameRing::wakeReaders(*header);
+    munmap(base, size);
+    shm_unlink(name.c_str());
+
+    std::cout << "Published " << index << " frames\n";
+    return 0;
+}